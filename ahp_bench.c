@@ -0,0 +1,125 @@
+#include "amiga_hunk_parser.h"
+#include "amiga_hunk_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark for the symbolization daemon: cold query (parse + query), cache hit latency for single address queries
+// and throughput for batched queries.
+
+#define HIT_QUERIES 10000
+#define BATCH_SIZE 4096
+#define THROUGHPUT_SECONDS 2.0
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void randomQuery(AHPQuery* query, const AHPInfo* info)
+{
+	const uint32_t section = (uint32_t)(rand() % info->sectionCount);
+	const uint32_t size = info->sections[section].memSize;
+
+	query->section = section;
+	query->offset = size ? (uint32_t)rand() % size : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char** argv)
+{
+	AHPQuery* queries;
+	AHPInfo* info;
+
+	if (argc < 2)
+	{
+		printf("Usage: %s <amiga executable> [socket]\n\n", argv[0]);
+		return 0;
+	}
+
+	// only used to generate addresses that are inside the sections
+
+	if (!(info = ahp_parse_file(argv[1])))
+		return 1;
+
+	AHPClient* client = ahp_client_connect(argc > 2 ? argv[2] : 0);
+
+	if (!client)
+	{
+		printf("Unable to connect to the daemon\n");
+		ahp_free(info);
+		return 1;
+	}
+
+	queries = (AHPQuery*)malloc(BATCH_SIZE * sizeof(AHPQuery));
+
+	for (int i = 0; i < BATCH_SIZE; ++i)
+		randomQuery(&queries[i], info);
+
+	double start = now();
+
+	if (!ahp_client_query(client, argv[1], queries, 1))
+	{
+		printf("Query failed\n");
+		goto end;
+	}
+
+	printf("First query:       %10.3f ms (includes parsing unless already cached)\n", (now() - start) * 1000.0);
+
+	double best = 1e9;
+	int failed = 0;
+	start = now();
+
+	for (int i = 0; i < HIT_QUERIES; ++i)
+	{
+		const double t = now();
+		failed += !ahp_client_query(client, argv[1], &queries[i % BATCH_SIZE], 1);
+		const double elapsed = now() - t;
+
+		if (elapsed < best)
+			best = elapsed;
+	}
+
+	const double hitTime = (now() - start) / HIT_QUERIES;
+
+	printf("Cache hit latency: %10.3f us avg %.3f us min (single address)\n", hitTime * 1e6, best * 1e6);
+
+	if (failed)
+	{
+		printf("%d of %d queries failed, the latency above isn't meaningful\n", failed, HIT_QUERIES);
+		goto end;
+	}
+
+	uint64_t total = 0;
+	start = now();
+
+	while (now() - start < THROUGHPUT_SECONDS)
+	{
+		if (!ahp_client_query(client, argv[1], queries, BATCH_SIZE))
+		{
+			printf("Query failed\n");
+			break;
+		}
+
+		total += BATCH_SIZE;
+	}
+
+	printf("Throughput:        %10.0f queries/s (batches of %d)\n", total / (now() - start), BATCH_SIZE);
+
+	end:
+
+	free(queries);
+	ahp_client_close(client);
+	ahp_free(info);
+
+	return 0;
+}
@@ -0,0 +1,535 @@
+#include "amiga_hunk_parser.h"
+#include "amiga_hunk_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbolization daemon. Keeps an LRU cache of parsed executables keyed on path + mtime + size and answers batched
+// address to symbol/line queries over a Unix domain socket (see amiga_hunk_protocol.h). When a cached executable
+// has been rebuilt it's updated with ahp_reparse() so unchanged sections don't have to be parsed again.
+//
+// The cache lock is only held to look up and publish entries. Parsing happens outside of it with the entry marked
+// busy (other requests for the same executable wait for it) and queries run on a reference to the parsed data, so
+// a slow parse of one executable doesn't hold up queries for the others.
+
+#define DEFAULT_CACHE_SIZE 16
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parsed executable, freed when the last reference goes away. The cache holds one reference while it's cached.
+
+typedef struct SharedInfo
+{
+	AHPInfo* info;
+	int refs;
+
+} SharedInfo;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct CacheEntry
+{
+	char* path;
+	int64_t mtimeSec;
+	int64_t mtimeNsec;
+	int64_t size;
+	uint64_t lastUse;
+	SharedInfo* shared;
+	int busy;	// being parsed, path is set but shared may be stale or 0
+
+} CacheEntry;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Connection
+{
+	int fd;
+
+	AHPQuery* queries;
+	AHPQueryReply* replies;
+	uint32_t capacity;
+
+	char* strings;
+	uint32_t stringSize;
+	uint32_t stringCapacity;
+
+} Connection;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static pthread_mutex_t s_cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cacheChanged = PTHREAD_COND_INITIALIZER;
+static CacheEntry* s_cache;
+static int s_cacheSize = DEFAULT_CACHE_SIZE;
+static uint64_t s_tick;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int readAll(int fd, void* data, size_t size)
+{
+	uint8_t* p = (uint8_t*)data;
+
+	while (size > 0)
+	{
+		ssize_t n = read(fd, p, size);
+
+		if (n <= 0)
+			return 0;
+
+		p += n;
+		size -= (size_t)n;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeAll(int fd, const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+
+	while (size > 0)
+	{
+		ssize_t n = write(fd, p, size);
+
+		if (n <= 0)
+			return 0;
+
+		p += n;
+		size -= (size_t)n;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Must be called with s_cacheLock held, returns the info to free (outside of the lock) if this was the last reference
+
+static AHPInfo* release(SharedInfo* shared)
+{
+	AHPInfo* info = 0;
+
+	if (shared && --shared->refs == 0)
+	{
+		info = shared->info;
+		free(shared);
+	}
+
+	return info;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void releaseInfo(SharedInfo* shared)
+{
+	pthread_mutex_lock(&s_cacheLock);
+	AHPInfo* info = release(shared);
+	pthread_mutex_unlock(&s_cacheLock);
+
+	if (info)
+		ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Must be called with s_cacheLock held
+
+static AHPInfo* clearEntry(CacheEntry* entry)
+{
+	AHPInfo* info = release(entry->shared);
+
+	free(entry->path);
+	memset(entry, 0, sizeof(CacheEntry));
+
+	return info;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Must be called with s_cacheLock held. Returns the entry for path, a free or least recently used entry that isn't
+// busy if there is none (*found is 0 then) or 0 if every entry is busy.
+
+static CacheEntry* findEntry(const char* path, int* found)
+{
+	CacheEntry* lru = 0;
+
+	*found = 0;
+
+	for (int i = 0; i < s_cacheSize; ++i)
+	{
+		CacheEntry* entry = &s_cache[i];
+
+		if (entry->path && !strcmp(entry->path, path))
+		{
+			*found = 1;
+			return entry;
+		}
+
+		if (entry->busy)
+			continue;
+
+		if (!lru || (lru->path && (!entry->path || entry->lastUse < lru->lastUse)))
+			lru = entry;
+	}
+
+	return lru;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns a reference to the parsed executable at path (release with releaseInfo) or 0 if it can't be parsed
+
+static SharedInfo* getInfo(const char* path)
+{
+	struct stat st;
+	CacheEntry* entry;
+	int found;
+
+	if (stat(path, &st) != 0)
+		return 0;
+
+#if defined(__APPLE__)
+	const int64_t mtimeSec = st.st_mtimespec.tv_sec;
+	const int64_t mtimeNsec = st.st_mtimespec.tv_nsec;
+#else
+	const int64_t mtimeSec = st.st_mtim.tv_sec;
+	const int64_t mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+
+	pthread_mutex_lock(&s_cacheLock);
+
+	// wait for the executable to be parsed if someone else is at it (or for an entry to reuse if all are busy)
+
+	while (!(entry = findEntry(path, &found)) || entry->busy)
+		pthread_cond_wait(&s_cacheChanged, &s_cacheLock);
+
+	entry->lastUse = ++s_tick;
+
+	if (found && entry->mtimeSec == mtimeSec && entry->mtimeNsec == mtimeNsec && entry->size == (int64_t)st.st_size)
+	{
+		SharedInfo* shared = entry->shared;
+		shared->refs++;
+		pthread_mutex_unlock(&s_cacheLock);
+		return shared;
+	}
+
+	AHPInfo* evicted = 0;
+	SharedInfo* prev = 0;
+
+	if (found)
+	{
+		// the previous parse can only be handed to ahp_reparse (which frees it) if no query is using it
+
+		if (entry->shared->refs == 1)
+			prev = entry->shared;
+		else
+			evicted = release(entry->shared);
+
+		entry->shared = 0;
+	}
+	else
+	{
+		evicted = clearEntry(entry);
+		entry->path = strdup(path);
+	}
+
+	entry->busy = 1;
+
+	pthread_mutex_unlock(&s_cacheLock);
+
+	if (evicted)
+		ahp_free(evicted);
+
+	AHPInfo* info = prev ? ahp_reparse(prev->info, path) : ahp_parse_file(path);
+
+	if (prev && !info)
+		ahp_free(prev->info);
+
+	SharedInfo* shared = prev;
+
+	if (!info)
+	{
+		free(prev);
+		shared = 0;
+	}
+	else
+	{
+		if (!shared)
+			shared = (SharedInfo*)malloc(sizeof(SharedInfo));
+
+		shared->info = info;
+		shared->refs = 2;	// the cache and the caller
+	}
+
+	pthread_mutex_lock(&s_cacheLock);
+
+	if (shared)
+	{
+		entry->shared = shared;
+		entry->mtimeSec = mtimeSec;
+		entry->mtimeNsec = mtimeNsec;
+		entry->size = (int64_t)st.st_size;
+		entry->busy = 0;
+	}
+	else
+	{
+		clearEntry(entry);
+	}
+
+	pthread_cond_broadcast(&s_cacheChanged);
+	pthread_mutex_unlock(&s_cacheLock);
+
+	return shared;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t addString(Connection* conn, const char* str)
+{
+	const uint32_t length = (uint32_t)strlen(str) + 1;
+	const uint32_t offset = conn->stringSize;
+
+	if (conn->stringSize + length > conn->stringCapacity)
+	{
+		conn->stringCapacity = (conn->stringSize + length) * 2;
+		conn->strings = (char*)realloc(conn->strings, conn->stringCapacity);
+	}
+
+	memcpy(conn->strings + offset, str, length);
+	conn->stringSize += length;
+
+	return offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void symbolize(Connection* conn, const AHPInfo* info, uint32_t count)
+{
+	const char* lastSymbol = 0;
+	const char* lastFilename = 0;
+	uint32_t lastSymbolOffset = 0, lastFilenameOffset = 0;
+
+	conn->stringSize = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const AHPQuery* query = &conn->queries[i];
+		AHPQueryReply* reply = &conn->replies[i];
+		const char* filename = 0;
+		int line = 0;
+
+		reply->symbol = AHP_NO_STRING;
+		reply->symbolOffset = 0;
+		reply->filename = AHP_NO_STRING;
+		reply->line = 0;
+
+		if (query->section >= (uint32_t)info->sectionCount)
+			continue;
+
+		const AHPSection* section = &info->sections[query->section];
+		const AHPSymbolInfo* symbol = ahp_find_symbol(section, query->offset);
+
+		// batches are usually sorted so only strings that differ from the previous entry are added
+
+		if (symbol)
+		{
+			if (symbol->name != lastSymbol)
+			{
+				lastSymbol = symbol->name;
+				lastSymbolOffset = addString(conn, symbol->name);
+			}
+
+			reply->symbol = lastSymbolOffset;
+			reply->symbolOffset = query->offset - symbol->address;
+		}
+
+		if (ahp_find_line(section, query->offset, &filename, &line))
+		{
+			if (filename != lastFilename)
+			{
+				lastFilename = filename;
+				lastFilenameOffset = addString(conn, filename);
+			}
+
+			reply->filename = lastFilenameOffset;
+			reply->line = (uint32_t)line;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int sendStatus(Connection* conn, AHPStatus status)
+{
+	AHPResponseHeader response = { AHP_PROTOCOL_MAGIC, status, 0, 0 };
+	return writeAll(conn->fd, &response, sizeof(response));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* connectionThread(void* arg)
+{
+	Connection* conn = (Connection*)arg;
+	AHPRequestHeader request;
+	char path[AHP_MAX_PATH_LENGTH + 1];
+
+	while (readAll(conn->fd, &request, sizeof(request)))
+	{
+		if (request.magic != AHP_PROTOCOL_MAGIC || request.pathLength > AHP_MAX_PATH_LENGTH ||
+			request.count > AHP_MAX_QUERIES)
+		{
+			sendStatus(conn, AHPStatus_BadRequest);
+			break;
+		}
+
+		if (request.count > conn->capacity)
+		{
+			conn->capacity = request.count;
+			conn->queries = (AHPQuery*)realloc(conn->queries, conn->capacity * sizeof(AHPQuery));
+			conn->replies = (AHPQueryReply*)realloc(conn->replies, conn->capacity * sizeof(AHPQueryReply));
+		}
+
+		if (!readAll(conn->fd, path, request.pathLength) ||
+			!readAll(conn->fd, conn->queries, request.count * sizeof(AHPQuery)))
+			break;
+
+		path[request.pathLength] = 0;
+
+		SharedInfo* shared = getInfo(path);
+
+		if (!shared)
+		{
+			if (!sendStatus(conn, AHPStatus_ParseFailed))
+				break;
+
+			continue;
+		}
+
+		symbolize(conn, shared->info, request.count);
+		releaseInfo(shared);
+
+		AHPResponseHeader response = { AHP_PROTOCOL_MAGIC, AHPStatus_Ok, request.count, conn->stringSize };
+
+		if (!writeAll(conn->fd, &response, sizeof(response)) ||
+			!writeAll(conn->fd, conn->replies, request.count * sizeof(AHPQueryReply)) ||
+			!writeAll(conn->fd, conn->strings, conn->stringSize))
+			break;
+	}
+
+	close(conn->fd);
+	free(conn->queries);
+	free(conn->replies);
+	free(conn->strings);
+	free(conn);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char** argv)
+{
+	static char defaultPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+	const char* socketPath = 0;
+	struct sockaddr_un addr;
+	struct stat st;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-s") && i + 1 < argc)
+			socketPath = argv[++i];
+		else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			s_cacheSize = atoi(argv[++i]);
+		else
+		{
+			printf("Usage: %s [-s <socket>] [-n <cached executables>]\n\n", argv[0]);
+			return 0;
+		}
+	}
+
+	if (s_cacheSize < 1)
+		s_cacheSize = 1;
+
+	if (!socketPath)
+	{
+		if (!ahp_client_socket_path(defaultPath, sizeof(defaultPath), 1))
+		{
+			printf("Unable to create a private directory for the socket, use -s <socket>\n");
+			return 1;
+		}
+
+		socketPath = defaultPath;
+	}
+
+	if (strlen(socketPath) >= sizeof(addr.sun_path))
+	{
+		printf("Socket path %s is too long\n", socketPath);
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	s_cache = (CacheEntry*)calloc(s_cacheSize, sizeof(CacheEntry));
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+
+	// a socket left behind by an earlier run is replaced, anything else at the path is left alone
+
+	if (lstat(socketPath, &st) == 0)
+	{
+		if (!S_ISSOCK(st.st_mode))
+		{
+			printf("%s exists and isn't a socket\n", socketPath);
+			return 1;
+		}
+
+		unlink(socketPath);
+	}
+
+	// only the user running the daemon may connect, the queries name files it will parse
+
+	const mode_t prevMask = umask(0177);
+	const int bound = fd >= 0 && bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+	umask(prevMask);
+
+	if (!bound || chmod(socketPath, 0600) < 0 || listen(fd, 64) < 0)
+	{
+		printf("Unable to listen on %s\n", socketPath);
+		return 1;
+	}
+
+	printf("Listening on %s (cache size %d)\n", socketPath, s_cacheSize);
+	fflush(stdout);
+
+	for (;;)
+	{
+		pthread_t thread;
+		int clientFd = accept(fd, 0, 0);
+
+		if (clientFd < 0)
+			continue;
+
+		Connection* conn = (Connection*)calloc(1, sizeof(Connection));
+		conn->fd = clientFd;
+
+		if (pthread_create(&thread, 0, connectionThread, conn) != 0)
+		{
+			close(clientFd);
+			free(conn);
+			continue;
+		}
+
+		pthread_detach(thread);
+	}
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include "amiga_hunk_elf.h"
+#include "amiga_hunk_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Converts m68k ELF files to hunk executables. With -b the conversion is repeated and the time spent reading,
+// converting, emitting and writing is reported (best of all runs).
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* readFile(const char* filename, size_t* size)
+{
+	FILE* f = fopen(filename, "rb");
+	void* data = 0;
+
+	*size = 0;
+
+	if (!f)
+		return 0;
+
+	fseek(f, 0, SEEK_END);
+	const long length = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	if (length > 0 && (data = malloc((size_t)length)) && fread(data, 1, (size_t)length, f) == (size_t)length)
+		*size = (size_t)length;
+
+	fclose(f);
+
+	if (*size == 0)
+	{
+		free(data);
+		return 0;
+	}
+
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int convertFile(const char* input, const char* output, double* times, uint32_t* outputSize)
+{
+	AHPWriter writer;
+	size_t size;
+	int result;
+
+	double t = now();
+	void* data = readFile(input, &size);
+
+	if (!data)
+	{
+		printf("Unable to read %s\n", input);
+		return 0;
+	}
+
+	times[0] = now() - t;
+	t = now();
+
+	AHPInfo* info = ahp_elf_convert(data, size);
+
+	free(data);
+
+	if (!info)
+		return 0;
+
+	times[1] = now() - t;
+	t = now();
+
+	// the output is roughly the size of the section data, which is at the start of fileData
+
+	ahp_writer_init(&writer, (uint32_t)size);
+	result = ahp_write_info(&writer, info);
+
+	times[2] = now() - t;
+	t = now();
+
+	if (result)
+		result = ahp_writer_save(&writer, output);
+
+	times[3] = now() - t;
+
+	*outputSize = writer.size;
+
+	ahp_writer_free(&writer);
+	ahp_free(info);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char** argv)
+{
+	static const char* phases[] = { "Read", "Convert", "Emit", "Write" };
+	double best[4] = { 1e9, 1e9, 1e9, 1e9 };
+	int iterations = 0;
+	uint32_t outputSize = 0;
+	int arg = 1;
+
+	if (argc == 5 && !strcmp(argv[1], "-b"))
+	{
+		iterations = atoi(argv[2]);
+		arg = 3;
+	}
+
+	if (argc != arg + 2)
+	{
+		printf("Usage: %s [-b <iterations>] <input.elf> <output>\n\n", argv[0]);
+		return 0;
+	}
+
+	for (int i = 0; i < (iterations > 0 ? iterations : 1); ++i)
+	{
+		double times[4];
+
+		if (!convertFile(argv[arg], argv[arg + 1], times, &outputSize))
+			return 1;
+
+		for (int p = 0; p < 4; ++p)
+		{
+			if (times[p] < best[p])
+				best[p] = times[p];
+		}
+	}
+
+	if (iterations > 0)
+	{
+		double total = 0.0;
+
+		for (int p = 0; p < 4; ++p)
+		{
+			printf("%-8s %10.3f ms\n", phases[p], best[p] * 1000.0);
+			total += best[p];
+		}
+
+		printf("Total    %10.3f ms, %u bytes written (%.1f MB/s)\n", total * 1000.0, outputSize,
+			   outputSize / total / (1024.0 * 1024.0));
+	}
+
+	return 0;
+}
@@ -0,0 +1,1127 @@
+#include "amiga_hunk_parser.h"
+#include "amiga_hunk_index.h"
+#include "doshunks.h"
+#include "endian.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Corpus scanner. "scan" walks a directory tree and parses every hunk executable in it, both on a pool of threads,
+// and writes an inverted index of symbol names and section hashes (see amiga_hunk_index.h). "symbol" and "section"
+// mmap the index and answer queries with binary searches, nothing is parsed again.
+
+#define ARENA_BLOCK_SIZE (256 * 1024)
+#define MAX_THREADS 256
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Entry
+{
+	const char* name;
+	uint32_t file;
+
+} Entry;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct ArenaBlock
+{
+	struct ArenaBlock* next;
+	uint32_t used;
+	uint32_t size;
+	char data[];
+
+} ArenaBlock;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol names are copied per thread since the parsed executables are freed as soon as they have been scanned
+
+typedef struct Worker
+{
+	pthread_t thread;
+
+	Entry* entries;
+	uint32_t entryCount;
+	uint32_t entryCapacity;
+
+	ArenaBlock* arena;
+
+} Worker;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct ScannedFile
+{
+	AHPIndexSection* sections;
+	uint32_t sectionCount;
+	uint32_t symbolCount;
+	int ok;
+
+} ScannedFile;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Buffer
+{
+	char* data;
+	uint64_t size;
+	uint64_t capacity;
+
+} Buffer;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static char** s_paths;
+static uint32_t s_pathCount;
+static uint32_t s_pathCapacity;
+
+// directories waiting to be read and the number being read, the walk is done when both are 0
+
+static char** s_dirs;
+static uint32_t s_dirCount;
+static uint32_t s_dirCapacity;
+static int s_busyWalkers;
+static pthread_mutex_t s_walkLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_walkChanged = PTHREAD_COND_INITIALIZER;
+
+static ScannedFile* s_files;
+static uint32_t s_nextFile;
+static pthread_mutex_t s_nextLock = PTHREAD_MUTEX_INITIALIZER;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* getTypeName(uint32_t type)
+{
+	switch (type)
+	{
+		case AHPSectionType_Code : return "CODE";
+		case AHPSectionType_Data : return "DATA";
+		case AHPSectionType_Bss : return "BSS ";
+	}
+
+	return "UNKN";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* getTargetName(uint32_t target)
+{
+	switch (target)
+	{
+		case AHPSectionTarget_Any : return "ANY ";
+		case AHPSectionTarget_Fast : return "FAST";
+		case AHPSectionTarget_Chip : return "CHIP";
+	}
+
+	return "UNKN";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Must be called with s_walkLock held
+
+static void addPath(const char* path)
+{
+	if (s_pathCount == s_pathCapacity)
+	{
+		s_pathCapacity = s_pathCapacity ? s_pathCapacity * 2 : 1024;
+		s_paths = (char**)realloc(s_paths, s_pathCapacity * sizeof(char*));
+	}
+
+	s_paths[s_pathCount++] = strdup(path);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Must be called with s_walkLock held
+
+static void addDirectory(char* path)
+{
+	if (s_dirCount == s_dirCapacity)
+	{
+		s_dirCapacity = s_dirCapacity ? s_dirCapacity * 2 : 256;
+		s_dirs = (char**)realloc(s_dirs, s_dirCapacity * sizeof(char*));
+	}
+
+	s_dirs[s_dirCount++] = path;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queues the subdirectories of dirname and adds the files in it. Symbolic links are not followed so links to parent
+// directories can't make the walk loop.
+
+static void readDirectory(const char* dirname)
+{
+	DIR* dir = opendir(dirname);
+	struct dirent* entry;
+
+	if (!dir)
+	{
+		printf("Unable to open directory %s\n", dirname);
+		return;
+	}
+
+	const size_t dirLength = strlen(dirname);
+	const int addSlash = dirLength > 0 && dirname[dirLength - 1] != '/';
+
+	while ((entry = readdir(dir)))
+	{
+		struct stat st;
+		const char* name = entry->d_name;
+		int isDir = 0, isFile = 0;
+
+		if (!strcmp(name, ".") || !strcmp(name, ".."))
+			continue;
+
+		const size_t length = dirLength + addSlash + strlen(name) + 1;
+		char* path = (char*)malloc(length);
+		snprintf(path, length, "%s%s%s", dirname, addSlash ? "/" : "", name);
+
+#ifdef _DIRENT_HAVE_D_TYPE
+		isDir = entry->d_type == DT_DIR;
+		isFile = entry->d_type == DT_REG;
+
+		if (entry->d_type == DT_UNKNOWN && lstat(path, &st) == 0)
+#else
+		if (lstat(path, &st) == 0)
+#endif
+		{
+			isDir = S_ISDIR(st.st_mode);
+			isFile = S_ISREG(st.st_mode);
+		}
+
+		if (!isDir && !isFile)
+		{
+			free(path);
+			continue;
+		}
+
+		pthread_mutex_lock(&s_walkLock);
+
+		if (isDir)
+		{
+			addDirectory(path);
+			pthread_cond_signal(&s_walkChanged);
+		}
+		else
+		{
+			addPath(path);
+			free(path);
+		}
+
+		pthread_mutex_unlock(&s_walkLock);
+	}
+
+	closedir(dir);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Takes directories off the queue until it's empty and no other thread is reading one (which could queue more)
+
+static void* walkThread(void* arg)
+{
+	(void)arg;
+
+	pthread_mutex_lock(&s_walkLock);
+
+	for (;;)
+	{
+		while (s_dirCount == 0 && s_busyWalkers > 0)
+			pthread_cond_wait(&s_walkChanged, &s_walkLock);
+
+		if (s_dirCount == 0)
+			break;
+
+		char* dirname = s_dirs[--s_dirCount];
+		s_busyWalkers++;
+
+		pthread_mutex_unlock(&s_walkLock);
+
+		readDirectory(dirname);
+		free(dirname);
+
+		pthread_mutex_lock(&s_walkLock);
+
+		s_busyWalkers--;
+		pthread_cond_broadcast(&s_walkChanged);
+	}
+
+	pthread_mutex_unlock(&s_walkLock);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int comparePaths(const void* a, const void* b)
+{
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks the hunk header id first so directories with other files in them don't spam parse errors
+
+static int isHunkFile(const char* path)
+{
+	uint8_t id[4];
+	int result = 0;
+	FILE* f = fopen(path, "rb");
+
+	if (!f)
+		return 0;
+
+	if (fread(id, 1, 4, f) == 4)
+		result = ahp_load_be32(id) == HUNK_HEADER;
+
+	fclose(f);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* arenaCopy(Worker* worker, const char* str)
+{
+	const uint32_t length = (uint32_t)strlen(str) + 1;
+	ArenaBlock* block = worker->arena;
+
+	if (!block || block->used + length > block->size)
+	{
+		const uint32_t size = length > ARENA_BLOCK_SIZE ? length : ARENA_BLOCK_SIZE;
+
+		block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size);
+		block->next = worker->arena;
+		block->used = 0;
+		block->size = size;
+
+		worker->arena = block;
+	}
+
+	char* copy = block->data + block->used;
+
+	memcpy(copy, str, length);
+	block->used += length;
+
+	return copy;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void scanFile(Worker* worker, uint32_t fileId)
+{
+	ScannedFile* file = &s_files[fileId];
+	AHPInfo* info;
+
+	if (!isHunkFile(s_paths[fileId]) || !(info = ahp_parse_file(s_paths[fileId])))
+		return;
+
+	file->ok = 1;
+	file->sectionCount = (uint32_t)info->sectionCount;
+	file->sections = (AHPIndexSection*)malloc(info->sectionCount * sizeof(AHPIndexSection));
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+		AHPIndexSection* out = &file->sections[i];
+
+		out->hash = ahp_section_hash(info, section);
+		out->memSize = (uint32_t)section->memSize;
+		out->type = (uint16_t)section->type;
+		out->target = (uint16_t)section->target;
+
+		if (worker->entryCount + section->symbolCount > worker->entryCapacity)
+		{
+			worker->entryCapacity = (worker->entryCount + section->symbolCount) * 2;
+			worker->entries = (Entry*)realloc(worker->entries, worker->entryCapacity * sizeof(Entry));
+		}
+
+		for (int s = 0; s < section->symbolCount; ++s)
+		{
+			Entry* entry = &worker->entries[worker->entryCount++];
+
+			entry->name = arenaCopy(worker, section->symbols[s].name);
+			entry->file = fileId;
+		}
+
+		file->symbolCount += (uint32_t)section->symbolCount;
+	}
+
+	ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareEntries(const void* a, const void* b)
+{
+	const Entry* ea = (const Entry*)a;
+	const Entry* eb = (const Entry*)b;
+	const int c = strcmp(ea->name, eb->name);
+
+	if (c)
+		return c;
+
+	return (ea->file > eb->file) - (ea->file < eb->file);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* workerThread(void* arg)
+{
+	Worker* worker = (Worker*)arg;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&s_nextLock);
+		const uint32_t fileId = s_nextFile++;
+		pthread_mutex_unlock(&s_nextLock);
+
+		if (fileId >= s_pathCount)
+			break;
+
+		scanFile(worker, fileId);
+	}
+
+	// each thread sorts its own entries, the sorted runs are merged when writing the index
+
+	if (worker->entryCount)
+		qsort(worker->entries, worker->entryCount, sizeof(Entry), compareEntries);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reserve(Buffer* buffer, uint64_t size)
+{
+	if (buffer->size + size <= buffer->capacity)
+		return;
+
+	buffer->capacity = (buffer->size + size) * 2;
+	buffer->data = (char*)realloc(buffer->data, buffer->capacity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* append(Buffer* buffer, uint64_t size)
+{
+	reserve(buffer, size);
+
+	void* data = buffer->data + buffer->size;
+	buffer->size += size;
+
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t addString(Buffer* strings, const char* str)
+{
+	const uint64_t offset = strings->size;
+	const size_t length = strlen(str) + 1;
+
+	memcpy(append(strings, length), str, length);
+
+	return (uint32_t)offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareHashes(const void* a, const void* b)
+{
+	const AHPIndexHash* ha = (const AHPIndexHash*)a;
+	const AHPIndexHash* hb = (const AHPIndexHash*)b;
+
+	if (ha->hash != hb->hash)
+		return ha->hash < hb->hash ? -1 : 1;
+
+	return (ha->section > hb->section) - (ha->section < hb->section);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeTable(FILE* f, const void* data, uint64_t size)
+{
+	static const uint8_t padding[8];
+
+	if (size && fwrite(data, 1, size, f) != size)
+		return 0;
+
+	return fwrite(padding, 1, (8 - (size & 7)) & 7, f) == ((8 - (size & 7)) & 7);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t align8(uint64_t v)
+{
+	return (v + 7) & ~(uint64_t)7;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Heap of the threads that still have entries, ordered by their next entry
+
+typedef struct MergeHeap
+{
+	const Worker* workers;
+	uint32_t cursors[MAX_THREADS];
+	int threads[MAX_THREADS];
+	int count;
+
+} MergeHeap;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const Entry* heapEntry(const MergeHeap* heap, int i)
+{
+	const int t = heap->threads[i];
+	return &heap->workers[t].entries[heap->cursors[t]];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void heapSiftDown(MergeHeap* heap, int i)
+{
+	for (;;)
+	{
+		const int left = i * 2 + 1, right = left + 1;
+		int smallest = i;
+
+		if (left < heap->count && compareEntries(heapEntry(heap, left), heapEntry(heap, smallest)) < 0)
+			smallest = left;
+
+		if (right < heap->count && compareEntries(heapEntry(heap, right), heapEntry(heap, smallest)) < 0)
+			smallest = right;
+
+		if (smallest == i)
+			return;
+
+		const int t = heap->threads[i];
+		heap->threads[i] = heap->threads[smallest];
+		heap->threads[smallest] = t;
+		i = smallest;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void heapInit(MergeHeap* heap, const Worker* workers, int threadCount)
+{
+	heap->workers = workers;
+	heap->count = 0;
+
+	for (int t = 0; t < threadCount; ++t)
+	{
+		heap->cursors[t] = 0;
+
+		if (workers[t].entryCount)
+			heap->threads[heap->count++] = t;
+	}
+
+	for (int i = heap->count / 2 - 1; i >= 0; --i)
+		heapSiftDown(heap, i);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the smallest entry of all threads and moves past it, 0 when all are done
+
+static const Entry* heapPop(MergeHeap* heap)
+{
+	if (heap->count == 0)
+		return 0;
+
+	const Entry* entry = heapEntry(heap, 0);
+	const int t = heap->threads[0];
+
+	if (++heap->cursors[t] >= heap->workers[t].entryCount)
+		heap->threads[0] = heap->threads[--heap->count];
+
+	heapSiftDown(heap, 0);
+
+	return entry;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeIndex(const char* filename, Worker* workers, int threadCount)
+{
+	AHPIndexHeader header;
+	Buffer files = { 0 }, symbols = { 0 }, postings = { 0 }, sections = { 0 }, strings = { 0 };
+	uint32_t* fileMap = (uint32_t*)malloc((s_pathCount ? s_pathCount : 1) * sizeof(uint32_t));
+	MergeHeap heap;
+	const char* lastName = 0;
+	const Entry* next;
+	uint32_t lastFile = 0;
+	int result = 0;
+
+	memset(&header, 0, sizeof(header));
+
+	// offset 0 is the empty string so the table is never empty
+
+	addString(&strings, "");
+
+	// files that failed to parse are left out and the rest renumbered, the order (by path) stays the same
+
+	for (uint32_t i = 0; i < s_pathCount; ++i)
+	{
+		const ScannedFile* scanned = &s_files[i];
+
+		if (!scanned->ok)
+			continue;
+
+		AHPIndexFile* file = (AHPIndexFile*)append(&files, sizeof(AHPIndexFile));
+
+		file->path = addString(&strings, s_paths[i]);
+		file->firstSection = header.sectionCount;
+		file->sectionCount = scanned->sectionCount;
+		file->symbolCount = scanned->symbolCount;
+
+		memcpy(append(&sections, scanned->sectionCount * sizeof(AHPIndexSection)), scanned->sections,
+			   scanned->sectionCount * sizeof(AHPIndexSection));
+
+		fileMap[i] = header.fileCount++;
+		header.sectionCount += scanned->sectionCount;
+	}
+
+	// k-way merge of the sorted runs from the threads, duplicates (same name in several sections) are dropped
+
+	heapInit(&heap, workers, threadCount);
+
+	while ((next = heapPop(&heap)))
+	{
+		const uint32_t file = fileMap[next->file];
+
+		if (!lastName || strcmp(lastName, next->name) != 0)
+		{
+			AHPIndexSymbol* symbol = (AHPIndexSymbol*)append(&symbols, sizeof(AHPIndexSymbol));
+
+			symbol->name = addString(&strings, next->name);
+			symbol->firstPosting = header.postingCount;
+			symbol->postingCount = 0;
+
+			header.symbolCount++;
+			lastName = next->name;
+		}
+		else if (file == lastFile)
+		{
+			continue;
+		}
+
+		*(uint32_t*)append(&postings, sizeof(uint32_t)) = file;
+		((AHPIndexSymbol*)symbols.data)[header.symbolCount - 1].postingCount++;
+
+		header.postingCount++;
+		lastFile = file;
+	}
+
+	const uint32_t hashCount = header.sectionCount ? header.sectionCount : 1;
+	AHPIndexHash* hashes = (AHPIndexHash*)malloc(hashCount * sizeof(AHPIndexHash));
+
+	for (uint32_t f = 0; f < header.fileCount; ++f)
+	{
+		const AHPIndexFile* file = &((const AHPIndexFile*)files.data)[f];
+
+		for (uint32_t s = 0; s < file->sectionCount; ++s)
+		{
+			AHPIndexHash* hash = &hashes[file->firstSection + s];
+
+			hash->hash = ((const AHPIndexSection*)sections.data)[file->firstSection + s].hash;
+			hash->file = f;
+			hash->section = file->firstSection + s;
+		}
+	}
+
+	if (header.sectionCount)
+		qsort(hashes, header.sectionCount, sizeof(AHPIndexHash), compareHashes);
+
+	if (strings.size > UINT32_MAX)
+	{
+		printf("String table is too large (%llu bytes)\n", (unsigned long long)strings.size);
+		goto end;
+	}
+
+	header.magic = AHP_INDEX_MAGIC;
+	header.version = AHP_INDEX_VERSION;
+	header.filesOffset = align8(sizeof(header));
+	header.symbolsOffset = align8(header.filesOffset + files.size);
+	header.postingsOffset = align8(header.symbolsOffset + symbols.size);
+	header.sectionsOffset = align8(header.postingsOffset + postings.size);
+	header.hashesOffset = align8(header.sectionsOffset + sections.size);
+	header.stringsOffset = align8(header.hashesOffset + header.sectionCount * sizeof(AHPIndexHash));
+	header.stringSize = strings.size;
+
+	// written to a temporary file that is renamed when complete so readers never see a partial index
+
+	const size_t tempLength = strlen(filename) + 5;
+	char* tempName = (char*)malloc(tempLength);
+	snprintf(tempName, tempLength, "%s.tmp", filename);
+
+	FILE* f = fopen(tempName, "wb");
+
+	if (!f)
+	{
+		printf("Unable to open %s for writing\n", tempName);
+		free(tempName);
+		goto end;
+	}
+
+	result = writeTable(f, &header, sizeof(header)) &&
+			 writeTable(f, files.data, files.size) &&
+			 writeTable(f, symbols.data, symbols.size) &&
+			 writeTable(f, postings.data, postings.size) &&
+			 writeTable(f, sections.data, sections.size) &&
+			 writeTable(f, hashes, header.sectionCount * sizeof(AHPIndexHash)) &&
+			 writeTable(f, strings.data, strings.size);
+
+	if (fclose(f) != 0)
+		result = 0;
+
+	if (!result || rename(tempName, filename) != 0)
+	{
+		printf("Unable to write %s\n", filename);
+		remove(tempName);
+		result = 0;
+	}
+	else
+	{
+		printf("%u files, %u unique symbols, %u postings, %u sections\n", header.fileCount, header.symbolCount,
+			   header.postingCount, header.sectionCount);
+	}
+
+	free(tempName);
+
+	end:
+
+	free(hashes);
+	free(fileMap);
+	free(files.data);
+	free(symbols.data);
+	free(postings.data);
+	free(sections.data);
+	free(strings.data);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Runs func on threadCount threads and waits for them, returns the number of threads that ran
+
+static int runThreads(Worker* workers, int threadCount, void* (*func)(void*))
+{
+	for (int t = 0; t < threadCount; ++t)
+	{
+		if (pthread_create(&workers[t].thread, 0, func, &workers[t]) != 0)
+		{
+			threadCount = t;
+			break;
+		}
+	}
+
+	// if no thread could be started the main thread does all the work
+
+	if (threadCount == 0)
+	{
+		func(&workers[0]);
+		return 1;
+	}
+
+	for (int t = 0; t < threadCount; ++t)
+		pthread_join(workers[t].thread, 0);
+
+	return threadCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int scan(const char* dirname, const char* indexName, int threadCount)
+{
+	Worker workers[MAX_THREADS];
+	const double start = now();
+	int result;
+
+	memset(workers, 0, sizeof(workers));
+
+	addDirectory(strdup(dirname));
+	runThreads(workers, threadCount, walkThread);
+	free(s_dirs);
+
+	// the walk order depends on the threads, file ids follow the path order so the index is the same every time
+
+	if (s_pathCount)
+		qsort(s_paths, s_pathCount, sizeof(char*), comparePaths);
+
+	const double walkTime = now() - start;
+
+	s_files = (ScannedFile*)calloc(s_pathCount ? s_pathCount : 1, sizeof(ScannedFile));
+
+	threadCount = runThreads(workers, threadCount, workerThread);
+
+	const double scanTime = now() - start - walkTime;
+
+	result = writeIndex(indexName, workers, threadCount);
+
+	printf("Walk %.3f s, parse %.3f s (%d threads), write %.3f s\n", walkTime, scanTime, threadCount,
+		   now() - start - walkTime - scanTime);
+
+	for (int t = 0; t < threadCount; ++t)
+	{
+		ArenaBlock* block = workers[t].arena;
+
+		while (block)
+		{
+			ArenaBlock* next = block->next;
+			free(block);
+			block = next;
+		}
+
+		free(workers[t].entries);
+	}
+
+	for (uint32_t i = 0; i < s_pathCount; ++i)
+	{
+		free(s_files[i].sections);
+		free(s_paths[i]);
+	}
+
+	free(s_files);
+	free(s_paths);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Index
+{
+	const uint8_t* data;
+	uint64_t size;
+
+	const AHPIndexHeader* header;
+	const AHPIndexFile* files;
+	const AHPIndexSymbol* symbols;
+	const uint32_t* postings;
+	const AHPIndexSection* sections;
+	const AHPIndexHash* hashes;
+	const char* strings;
+
+} Index;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int tableFits(const Index* index, uint64_t offset, uint64_t count, uint64_t elementSize)
+{
+	return offset <= index->size && (offset & 7) == 0 && count <= (index->size - offset) / elementSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Only the table bounds are validated here so opening stays O(1), entries are checked when they are used
+
+static int openIndex(Index* index, const char* filename)
+{
+	struct stat st;
+	int fd = open(filename, O_RDONLY);
+
+	memset(index, 0, sizeof(Index));
+
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(AHPIndexHeader))
+	{
+		printf("Unable to open index %s\n", filename);
+
+		if (fd >= 0)
+			close(fd);
+
+		return 0;
+	}
+
+	void* data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+	{
+		printf("Unable to map index %s\n", filename);
+		return 0;
+	}
+
+	index->data = (const uint8_t*)data;
+	index->size = (uint64_t)st.st_size;
+
+	const AHPIndexHeader* header = index->header = (const AHPIndexHeader*)data;
+
+	if (header->magic != AHP_INDEX_MAGIC || header->version != AHP_INDEX_VERSION ||
+		!tableFits(index, header->filesOffset, header->fileCount, sizeof(AHPIndexFile)) ||
+		!tableFits(index, header->symbolsOffset, header->symbolCount, sizeof(AHPIndexSymbol)) ||
+		!tableFits(index, header->postingsOffset, header->postingCount, sizeof(uint32_t)) ||
+		!tableFits(index, header->sectionsOffset, header->sectionCount, sizeof(AHPIndexSection)) ||
+		!tableFits(index, header->hashesOffset, header->sectionCount, sizeof(AHPIndexHash)) ||
+		!tableFits(index, header->stringsOffset, header->stringSize, 1) ||
+		header->stringSize == 0 || index->data[header->stringsOffset + header->stringSize - 1] != 0)
+	{
+		printf("%s is not a valid index\n", filename);
+		munmap(data, index->size);
+		return 0;
+	}
+
+	index->files = (const AHPIndexFile*)(index->data + header->filesOffset);
+	index->symbols = (const AHPIndexSymbol*)(index->data + header->symbolsOffset);
+	index->postings = (const uint32_t*)(index->data + header->postingsOffset);
+	index->sections = (const AHPIndexSection*)(index->data + header->sectionsOffset);
+	index->hashes = (const AHPIndexHash*)(index->data + header->hashesOffset);
+	index->strings = (const char*)(index->data + header->stringsOffset);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void closeIndex(Index* index)
+{
+	munmap((void*)index->data, index->size);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* indexString(const Index* index, uint32_t offset)
+{
+	return offset < index->header->stringSize ? index->strings + offset : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* filePath(const Index* index, uint32_t file)
+{
+	return file < index->header->fileCount ? indexString(index, index->files[file].path) : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// First symbol that isn't less than name, only the first length characters are compared so this finds prefixes too
+
+static uint32_t lowerBound(const Index* index, const char* name, size_t length)
+{
+	uint32_t low = 0, high = index->header->symbolCount;
+
+	while (low < high)
+	{
+		const uint32_t mid = (low + high) / 2;
+
+		if (strncmp(indexString(index, index->symbols[mid].name), name, length) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printPostings(const Index* index, const AHPIndexSymbol* symbol, int showName)
+{
+	const uint64_t first = symbol->firstPosting;
+	const uint64_t count = symbol->postingCount;
+
+	if (first + count > index->header->postingCount)
+		return;
+
+	for (uint64_t i = first; i < first + count; ++i)
+	{
+		if (showName)
+			printf("%s  %s\n", indexString(index, symbol->name), filePath(index, index->postings[i]));
+		else
+			printf("%s\n", filePath(index, index->postings[i]));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A name ending with * matches all symbols starting with the rest of it
+
+static int querySymbol(const char* indexName, const char* name)
+{
+	const double start = now();
+	size_t length = strlen(name);
+	uint32_t matches = 0;
+	Index index;
+
+	if (!openIndex(&index, indexName))
+		return 0;
+
+	const int prefix = length > 0 && name[length - 1] == '*';
+
+	if (prefix)
+		length--;
+
+	for (uint32_t i = lowerBound(&index, name, length); i < index.header->symbolCount; ++i)
+	{
+		const AHPIndexSymbol* symbol = &index.symbols[i];
+		const char* symbolName = indexString(&index, symbol->name);
+
+		if (strncmp(symbolName, name, length) != 0 || (!prefix && symbolName[length] != 0))
+			break;
+
+		printPostings(&index, symbol, prefix);
+		matches += symbol->postingCount;
+	}
+
+	printf("%u matches (%.3f ms)\n", matches, (now() - start) * 1000.0);
+
+	closeIndex(&index);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t findHash(const Index* index, uint64_t hash, int print)
+{
+	uint32_t low = 0, high = index->header->sectionCount, matches = 0;
+
+	while (low < high)
+	{
+		const uint32_t mid = (low + high) / 2;
+
+		if (index->hashes[mid].hash < hash)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (; low < index->header->sectionCount && index->hashes[low].hash == hash; ++low, ++matches)
+	{
+		const AHPIndexHash* entry = &index->hashes[low];
+
+		if (!print || entry->file >= index->header->fileCount || entry->section >= index->header->sectionCount)
+			continue;
+
+		const AHPIndexFile* file = &index->files[entry->file];
+		const AHPIndexSection* section = &index->sections[entry->section];
+
+		printf("  %s  section %u %s %s %u\n", filePath(index, entry->file), entry->section - file->firstSection,
+			   getTypeName(section->type), getTargetName(section->target), section->memSize);
+	}
+
+	return matches;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Looks up every section of an executable, or a hash (hex) if there is no file with that name
+
+static int querySection(const char* indexName, const char* arg)
+{
+	const double start = now();
+	uint32_t matches = 0;
+	struct stat st;
+	Index index;
+	char* end;
+
+	if (stat(arg, &st) != 0)
+	{
+		const uint64_t hash = strtoull(arg, &end, 16);
+
+		if (*end != 0 || end == arg)
+		{
+			printf("%s is neither an executable nor a section hash\n", arg);
+			return 0;
+		}
+
+		if (!openIndex(&index, indexName))
+			return 0;
+
+		printf("%016llx\n", (unsigned long long)hash);
+		matches = findHash(&index, hash, 1);
+	}
+	else
+	{
+		AHPInfo* info = ahp_parse_file(arg);
+
+		if (!info)
+			return 0;
+
+		if (!openIndex(&index, indexName))
+		{
+			ahp_free(info);
+			return 0;
+		}
+
+		for (int i = 0; i < info->sectionCount; ++i)
+		{
+			const AHPSection* section = &info->sections[i];
+			const uint64_t hash = ahp_section_hash(info, section);
+
+			printf("Section %d %s %s %u %016llx\n", i, getTypeName(section->type), getTargetName(section->target),
+				   (uint32_t)section->memSize, (unsigned long long)hash);
+
+			matches += findHash(&index, hash, 1);
+		}
+
+		ahp_free(info);
+	}
+
+	printf("%u matches (%.3f ms)\n", matches, (now() - start) * 1000.0);
+
+	closeIndex(&index);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void usage(const char* name)
+{
+	printf("Usage: %s scan [-j <threads>] <directory> <index>\n", name);
+	printf("       %s symbol <index> <name>            (name* matches a prefix)\n", name);
+	printf("       %s section <index> <hash | executable>\n\n", name);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, const char** argv)
+{
+	if (argc >= 4 && !strcmp(argv[1], "scan"))
+	{
+		long threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+		int arg = 2;
+
+		if (!strcmp(argv[arg], "-j") && argc >= 6)
+		{
+			threadCount = atoi(argv[arg + 1]);
+			arg += 2;
+		}
+
+		if (argc != arg + 2)
+		{
+			usage(argv[0]);
+			return 0;
+		}
+
+		if (threadCount < 1)
+			threadCount = 1;
+		else if (threadCount > MAX_THREADS)
+			threadCount = MAX_THREADS;
+
+		return scan(argv[arg], argv[arg + 1], (int)threadCount) ? 0 : 1;
+	}
+
+	if (argc == 4 && !strcmp(argv[1], "symbol"))
+		return querySymbol(argv[2], argv[3]) ? 0 : 1;
+
+	if (argc == 4 && !strcmp(argv[1], "section"))
+		return querySection(argv[2], argv[3]) ? 0 : 1;
+
+	usage(argv[0]);
+
+	return 0;
+}
@@ -0,0 +1,207 @@
+#include "amiga_hunk_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// The client is linked into other programs, a daemon that goes away mid request must not kill them with SIGPIPE.
+// Where send doesn't take MSG_NOSIGNAL the socket is set up with SO_NOSIGPIPE instead
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int readAll(int fd, void* data, size_t size)
+{
+	uint8_t* p = (uint8_t*)data;
+
+	while (size > 0)
+	{
+		ssize_t n = read(fd, p, size);
+
+		if (n <= 0)
+			return 0;
+
+		p += n;
+		size -= (size_t)n;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeAll(int fd, const void* data, size_t size)
+{
+	const uint8_t* p = (const uint8_t*)data;
+
+	while (size > 0)
+	{
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+
+		if (n <= 0)
+			return 0;
+
+		p += n;
+		size -= (size_t)n;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_client_socket_path(char* path, size_t size, int create)
+{
+	const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+	char dir[64];
+	struct stat st;
+
+	if (runtimeDir && runtimeDir[0])
+		return snprintf(path, size, "%s/%s", runtimeDir, AHP_SOCKET_NAME) < (int)size;
+
+	snprintf(dir, sizeof(dir), "/tmp/ahpd-%u", (unsigned)getuid());
+
+	if (create && mkdir(dir, 0700) < 0 && errno != EEXIST)
+		return 0;
+
+	// anyone can create it first in /tmp so it's only used if it's ours and private
+
+	if (lstat(dir, &st) < 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077))
+		return 0;
+
+	return snprintf(path, size, "%s/%s", dir, AHP_SOCKET_NAME) < (int)size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPClient* ahp_client_connect(const char* socketPath)
+{
+	char defaultPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+	struct sockaddr_un addr;
+
+	if (!socketPath)
+	{
+		if (!ahp_client_socket_path(defaultPath, sizeof(defaultPath), 0))
+			return 0;
+
+		socketPath = defaultPath;
+	}
+
+	if (strlen(socketPath) >= sizeof(addr.sun_path))
+		return 0;
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0)
+		return 0;
+
+#ifdef SO_NOSIGPIPE
+	const int noSigPipe = 1;
+
+	if (setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe)) < 0)
+	{
+		close(fd);
+		return 0;
+	}
+#endif
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return 0;
+	}
+
+	AHPClient* client = (AHPClient*)calloc(1, sizeof(AHPClient));
+	client->socket = fd;
+
+	return client;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_client_close(AHPClient* client)
+{
+	if (!client)
+		return;
+
+	close(client->socket);
+	free(client->results);
+	free(client->replies);
+	free(client->strings);
+	free(client);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const AHPClientResult* ahp_client_query(AHPClient* client, const char* path, const AHPQuery* queries, uint32_t count)
+{
+	AHPRequestHeader request;
+	AHPResponseHeader response;
+	const size_t pathLength = strlen(path);
+
+	if (pathLength > AHP_MAX_PATH_LENGTH || count > AHP_MAX_QUERIES)
+		return 0;
+
+	request.magic = AHP_PROTOCOL_MAGIC;
+	request.pathLength = (uint32_t)pathLength;
+	request.count = count;
+
+	if (!writeAll(client->socket, &request, sizeof(request)) ||
+		!writeAll(client->socket, path, pathLength) ||
+		!writeAll(client->socket, queries, count * sizeof(AHPQuery)))
+		return 0;
+
+	if (!readAll(client->socket, &response, sizeof(response)) || response.magic != AHP_PROTOCOL_MAGIC)
+		return 0;
+
+	if (response.status != AHPStatus_Ok || response.count != count)
+		return 0;
+
+	if (count > client->resultCapacity)
+	{
+		client->resultCapacity = count;
+		client->results = (AHPClientResult*)realloc(client->results, count * sizeof(AHPClientResult));
+		client->replies = (AHPQueryReply*)realloc(client->replies, count * sizeof(AHPQueryReply));
+	}
+
+	// one more byte is needed for the terminator
+
+	if (response.stringSize == UINT32_MAX)
+		return 0;
+
+	if (response.stringSize + 1 > client->stringCapacity)
+	{
+		client->stringCapacity = response.stringSize + 1;
+		client->strings = (char*)realloc(client->strings, client->stringCapacity);
+	}
+
+	if (!readAll(client->socket, client->replies, count * sizeof(AHPQueryReply)) ||
+		!readAll(client->socket, client->strings, response.stringSize))
+		return 0;
+
+	client->strings[response.stringSize] = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const AHPQueryReply* reply = &client->replies[i];
+		AHPClientResult* result = &client->results[i];
+
+		result->symbol = reply->symbol < response.stringSize ? client->strings + reply->symbol : 0;
+		result->symbolOffset = reply->symbolOffset;
+		result->filename = reply->filename < response.stringSize ? client->strings + reply->filename : 0;
+		result->line = (int)reply->line;
+	}
+
+	return client->results;
+}
@@ -0,0 +1,51 @@
+#ifndef AMIGA_HUNK_CLIENT_
+#define AMIGA_HUNK_CLIENT_
+
+#include "amiga_hunk_protocol.h"
+#include <stddef.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Client for the symbolization daemon (ahpd). The daemon keeps parsed executables cached so short lived tools can
+// symbolize addresses without parsing the executable themselves.
+
+typedef struct AHPClientResult
+{
+	const char* symbol;		// 0 if no symbol covers the address
+	uint32_t symbolOffset;
+	const char* filename;	// 0 if there is no line info
+	int line;
+
+} AHPClientResult;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPClient
+{
+	int socket;
+
+	// reply buffers, reused between queries
+
+	AHPClientResult* results;
+	AHPQueryReply* replies;
+	char* strings;
+	uint32_t resultCapacity;
+	uint32_t stringCapacity;
+
+} AHPClient;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Default socket path: AHP_SOCKET_NAME in $XDG_RUNTIME_DIR or else in /tmp/ahpd-<uid>, a directory that must be
+// owned by the user and closed to everyone else. With create set the latter is created if it doesn't exist.
+// Returns 0 if the directory can't be used or the path doesn't fit in size bytes.
+int ahp_client_socket_path(char* path, size_t size, int create);
+
+// socketPath can be 0 for the default socket
+AHPClient* ahp_client_connect(const char* socketPath);
+void ahp_client_close(AHPClient* client);
+
+// Symbolizes count (section, offset) pairs of the executable at path. Returns the results or 0 on failure.
+// The results (and strings in them) stay valid until the next query on the same client.
+const AHPClientResult* ahp_client_query(AHPClient* client, const char* path, const AHPQuery* queries, uint32_t count);
+
+#endif
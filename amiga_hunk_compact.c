@@ -0,0 +1,348 @@
+#include "amiga_hunk_compact.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Byte offsets of the tables, computed up front so the blob is allocated once
+
+typedef struct Layout
+{
+	uint64_t sections;
+	uint64_t symbols;
+	uint64_t lineFiles;
+	uint64_t lines;
+	uint64_t debugBlocks;
+	uint64_t relocs;
+	uint64_t strings;
+	uint64_t stringSize;
+	uint64_t size;
+
+} Layout;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t align8(uint64_t value)
+{
+	return (value + 7) & ~(uint64_t)7;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* safeString(const char* str)
+{
+	return str ? str : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void measure(const AHPInfo* info, Layout* layout)
+{
+	uint64_t symbolCount = 0, lineFileCount = 0, lineCount = 0, debugBlockCount = 0, relocCount = 0;
+	uint64_t stringSize = 1; // offset 0 is the empty string
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+
+		for (int s = 0; s < section->symbolCount; ++s)
+			stringSize += strlen(safeString(section->symbols[s].name)) + 1;
+
+		for (int d = 0; d < section->debugLineCount; ++d)
+		{
+			lineCount += section->debugLines[d].count;
+			stringSize += strlen(safeString(section->debugLines[d].filename)) + 1;
+		}
+
+		symbolCount += section->symbolCount;
+		lineFileCount += section->debugLineCount;
+		debugBlockCount += section->debugBlockCount;
+		relocCount += section->relocCount;
+	}
+
+	layout->sections = align8(sizeof(AHPCompact));
+	layout->symbols = align8(layout->sections + info->sectionCount * sizeof(AHPCompactSection));
+	layout->lineFiles = align8(layout->symbols + symbolCount * sizeof(AHPCompactSymbol));
+	layout->lines = align8(layout->lineFiles + lineFileCount * sizeof(AHPCompactLineFile));
+	layout->debugBlocks = align8(layout->lines + lineCount * sizeof(AHPCompactLine));
+	layout->relocs = align8(layout->debugBlocks + debugBlockCount * sizeof(AHPDebugBlock));
+	layout->strings = align8(layout->relocs + relocCount * sizeof(AHPReloc));
+	layout->stringSize = stringSize;
+	layout->size = align8(layout->strings + stringSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t addString(uint8_t* blob, const Layout* layout, uint32_t* stringCursor, const char* str)
+{
+	const size_t length = strlen(safeString(str));
+	const uint32_t offset = *stringCursor;
+
+	if (length == 0)
+		return 0;
+
+	memcpy(blob + layout->strings + offset, str, length + 1);
+	*stringCursor += (uint32_t)length + 1;
+
+	return offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPCompact* ahp_compact_create(const AHPInfo* info)
+{
+	Layout layout;
+	uint32_t symbolCursor, lineFileCursor, lineCursor, debugBlockCursor, relocCursor, stringCursor = 1;
+
+	measure(info, &layout);
+
+	if (layout.size > 0xffffffff)
+	{
+		printf("Metadata is too large for the compact model (%llu bytes)\n", (unsigned long long)layout.size);
+		return 0;
+	}
+
+	// zeroed so the padding between tables is always the same, blobs of the same file compare equal
+
+	uint8_t* blob = calloc(1, (size_t)layout.size);
+	AHPCompact* compact = (AHPCompact*)blob;
+
+	if (!blob)
+		return 0;
+
+	compact->magic = AHP_COMPACT_MAGIC;
+	compact->size = (uint32_t)layout.size;
+	compact->sectionCount = (uint32_t)info->sectionCount;
+	compact->sections = (uint32_t)layout.sections;
+	compact->strings = (uint32_t)layout.strings;
+	compact->stringSize = (uint32_t)layout.stringSize;
+
+	symbolCursor = (uint32_t)layout.symbols;
+	lineFileCursor = (uint32_t)layout.lineFiles;
+	lineCursor = (uint32_t)layout.lines;
+	debugBlockCursor = (uint32_t)layout.debugBlocks;
+	relocCursor = (uint32_t)layout.relocs;
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+		AHPCompactSection* out = (AHPCompactSection*)(blob + layout.sections) + i;
+
+		out->hash = ahp_section_hash(info, section);
+		out->hunkStart = section->hunkStart;
+		out->hunkSize = section->hunkSize;
+		out->type = (uint8_t)section->type;
+		out->target = (uint8_t)section->target;
+		out->memSize = (uint32_t)section->memSize;
+		out->dataSize = (uint32_t)section->dataSize;
+		out->dataStart = section->dataStart;
+
+		out->symbols = symbolCursor;
+		out->symbolCount = (uint32_t)section->symbolCount;
+
+		for (int s = 0; s < section->symbolCount; ++s)
+		{
+			AHPCompactSymbol* symbol = (AHPCompactSymbol*)(blob + symbolCursor);
+
+			symbol->name = addString(blob, &layout, &stringCursor, section->symbols[s].name);
+			symbol->address = section->symbols[s].address;
+			symbolCursor += sizeof(AHPCompactSymbol);
+		}
+
+		out->lineFiles = lineFileCursor;
+		out->lineFileCount = (uint32_t)section->debugLineCount;
+
+		for (int d = 0; d < section->debugLineCount; ++d)
+		{
+			const AHPLineInfo* lineInfo = &section->debugLines[d];
+			AHPCompactLineFile* lineFile = (AHPCompactLineFile*)(blob + lineFileCursor);
+			AHPCompactLine* lines = (AHPCompactLine*)(blob + lineCursor);
+
+			lineFile->filename = addString(blob, &layout, &stringCursor, lineInfo->filename);
+			lineFile->baseOffset = lineInfo->baseOffset;
+			lineFile->lines = lineCursor;
+			lineFile->count = (uint32_t)lineInfo->count;
+
+			for (int l = 0; l < lineInfo->count; ++l)
+			{
+				lines[l].address = lineInfo->addresses[l];
+				lines[l].line = (uint32_t)lineInfo->lines[l];
+			}
+
+			lineFileCursor += sizeof(AHPCompactLineFile);
+			lineCursor += (uint32_t)(lineInfo->count * sizeof(AHPCompactLine));
+		}
+
+		out->debugBlocks = debugBlockCursor;
+		out->debugBlockCount = (uint32_t)section->debugBlockCount;
+
+		if (section->debugBlockCount > 0)
+			memcpy(blob + debugBlockCursor, section->debugBlocks, section->debugBlockCount * sizeof(AHPDebugBlock));
+
+		debugBlockCursor += (uint32_t)(section->debugBlockCount * sizeof(AHPDebugBlock));
+
+		out->relocs = relocCursor;
+		out->relocCount = (uint32_t)section->relocCount;
+
+		if (section->relocCount > 0)
+			memcpy(blob + relocCursor, section->relocs, section->relocCount * sizeof(AHPReloc));
+
+		relocCursor += (uint32_t)(section->relocCount * sizeof(AHPReloc));
+	}
+
+	return compact;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int tableInRange(uint32_t size, uint32_t offset, uint32_t count, uint32_t elementSize, uint32_t alignment)
+{
+	if (offset & (alignment - 1))
+		return 0;
+
+	return offset <= size && (uint64_t)count * elementSize <= size - offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_compact_validate(const void* data, uint32_t size)
+{
+	const AHPCompact* compact = (const AHPCompact*)data;
+
+	if (((uintptr_t)data & 7) || size < sizeof(AHPCompact))
+		return 0;
+
+	if (compact->magic != AHP_COMPACT_MAGIC || compact->size > size)
+		return 0;
+
+	size = compact->size;
+
+	if (compact->stringSize == 0 || !tableInRange(size, compact->strings, compact->stringSize, 1, 1))
+		return 0;
+
+	// every string ends before the end of the string table so the last byte has to be a terminator
+
+	if (ahp_compact_string(compact, compact->stringSize - 1)[0] != 0)
+		return 0;
+
+	if (!tableInRange(size, compact->sections, compact->sectionCount, sizeof(AHPCompactSection), 8))
+		return 0;
+
+	for (uint32_t i = 0; i < compact->sectionCount; ++i)
+	{
+		const AHPCompactSection* section = ahp_compact_section(compact, (int)i);
+
+		if (!tableInRange(size, section->symbols, section->symbolCount, sizeof(AHPCompactSymbol), 4) ||
+			!tableInRange(size, section->lineFiles, section->lineFileCount, sizeof(AHPCompactLineFile), 4) ||
+			!tableInRange(size, section->debugBlocks, section->debugBlockCount, sizeof(AHPDebugBlock), 4) ||
+			!tableInRange(size, section->relocs, section->relocCount, sizeof(AHPReloc), 4))
+			return 0;
+
+		const AHPCompactSymbol* symbols = ahp_compact_symbols(compact, section);
+
+		// the lookups are binary searches, unsorted tables would give wrong answers instead of failing
+
+		for (uint32_t s = 0; s < section->symbolCount; ++s)
+		{
+			if (symbols[s].name >= compact->stringSize || (s > 0 && symbols[s].address < symbols[s - 1].address))
+				return 0;
+		}
+
+		const AHPCompactLineFile* lineFiles = ahp_compact_line_files(compact, section);
+
+		for (uint32_t d = 0; d < section->lineFileCount; ++d)
+		{
+			if (lineFiles[d].filename >= compact->stringSize ||
+				!tableInRange(size, lineFiles[d].lines, lineFiles[d].count, sizeof(AHPCompactLine), 4))
+				return 0;
+
+			const AHPCompactLine* lines = ahp_compact_lines(compact, &lineFiles[d]);
+
+			for (uint32_t l = 1; l < lineFiles[d].count; ++l)
+			{
+				if (lines[l].address < lines[l - 1].address)
+					return 0;
+			}
+		}
+
+		const AHPReloc* relocs = ahp_compact_relocs(compact, section);
+
+		for (uint32_t r = 0; r < section->relocCount; ++r)
+		{
+			if (relocs[r].target >= compact->sectionCount)
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const AHPCompactSymbol* ahp_compact_find_symbol(const AHPCompact* compact, const AHPCompactSection* section,
+												uint32_t offset)
+{
+	const AHPCompactSymbol* symbols = ahp_compact_symbols(compact, section);
+	uint32_t low = 0, high = section->symbolCount;
+
+	// first symbol with an address above offset
+
+	while (low < high)
+	{
+		const uint32_t mid = (low + high) / 2;
+
+		if (symbols[mid].address <= offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low > 0 ? &symbols[low - 1] : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_compact_find_line(const AHPCompact* compact, const AHPCompactSection* section, uint32_t offset,
+						  const char** filename, int* line)
+{
+	const AHPCompactLineFile* lineFiles = ahp_compact_line_files(compact, section);
+	uint32_t bestAddress = 0;
+	int found = 0;
+
+	for (uint32_t dli = 0; dli < section->lineFileCount; ++dli)
+	{
+		const AHPCompactLineFile* lineFile = &lineFiles[dli];
+		const AHPCompactLine* lines = ahp_compact_lines(compact, lineFile);
+		uint32_t low = 0, high = lineFile->count;
+
+		if (offset < lineFile->baseOffset)
+			continue;
+
+		const uint32_t address = offset - lineFile->baseOffset;
+
+		while (low < high)
+		{
+			const uint32_t mid = (low + high) / 2;
+
+			if (lines[mid].address <= address)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		if (low == 0)
+			continue;
+
+		const uint32_t lineAddress = lineFile->baseOffset + lines[low - 1].address;
+
+		if (!found || lineAddress > bestAddress)
+		{
+			bestAddress = lineAddress;
+			*filename = ahp_compact_string(compact, lineFile->filename);
+			*line = (int)lines[low - 1].line;
+			found = 1;
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,147 @@
+#ifndef AMIGA_HUNK_COMPACT_
+#define AMIGA_HUNK_COMPACT_
+
+#include "amiga_hunk_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compact copy of the metadata of a parsed executable (sections, symbols, line info, debug blocks and relocations)
+// for keeping a large number of files resident. Everything is in one allocation and refers to other parts of it by
+// 32-bit byte offsets from the start of the blob, so it doesn't need the AHPInfo or its fileData anymore and can be
+// copied, written to disk or put in shared memory as is. Host byte order, every table is aligned to 8 bytes.
+//
+// Debug blocks are copied as the file offsets the parser found them at (like dataStart), the stabs or other data in
+// them stays in the file.
+//
+// Layout: AHPCompact, sections, symbols, line files, lines, debug blocks, relocations, strings.
+
+#define AHP_COMPACT_MAGIC 0x41485043 // 'AHPC'
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPCompact
+{
+	uint32_t magic;
+	uint32_t size;			// of the whole blob
+	uint32_t sectionCount;
+	uint32_t sections;		// AHPCompactSection[sectionCount]
+	uint32_t strings;
+	uint32_t stringSize;
+
+} AHPCompact;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPCompactSection
+{
+	uint64_t hash;			// ahp_section_hash
+	uint32_t hunkStart;
+	uint32_t hunkSize;
+
+	uint8_t type;			// AHPSectionType
+	uint8_t target;			// AHPSectionTarget
+	uint16_t reserved;
+	uint32_t memSize;
+	uint32_t dataSize;
+	uint32_t dataStart;
+
+	uint32_t symbols;		// AHPCompactSymbol[symbolCount], sorted by address
+	uint32_t symbolCount;
+	uint32_t lineFiles;		// AHPCompactLineFile[lineFileCount]
+	uint32_t lineFileCount;
+	uint32_t debugBlocks;	// AHPDebugBlock[debugBlockCount]
+	uint32_t debugBlockCount;
+	uint32_t relocs;		// AHPReloc[relocCount]
+	uint32_t relocCount;
+
+} AHPCompactSection;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPCompactSymbol
+{
+	uint32_t name;			// string offset
+	uint32_t address;
+
+} AHPCompactSymbol;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A LINE debug block, address and line are interleaved instead of the two arrays of AHPLineInfo
+
+typedef struct AHPCompactLineFile
+{
+	uint32_t filename;		// string offset
+	uint32_t baseOffset;
+	uint32_t lines;			// AHPCompactLine[count]
+	uint32_t count;
+
+} AHPCompactLineFile;
+
+typedef struct AHPCompactLine
+{
+	uint32_t address;		// relative to baseOffset
+	uint32_t line;
+
+} AHPCompactLine;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Allocated with malloc, release it with free(). Returns 0 if the data doesn't fit in 32-bit offsets.
+AHPCompact* ahp_compact_create(const AHPInfo* info);
+
+// Checks that a blob from somewhere else (a file, shared memory) is complete, that all offsets in it stay inside it
+// and that symbols and lines are sorted by address as the lookups need them, returns 0 if not. Blobs created from
+// parsed or converted files are always valid.
+int ahp_compact_validate(const void* data, uint32_t size);
+
+const AHPCompactSymbol* ahp_compact_find_symbol(const AHPCompact* compact, const AHPCompactSection* section,
+												uint32_t offset);
+
+int ahp_compact_find_line(const AHPCompact* compact, const AHPCompactSection* section, uint32_t offset,
+						  const char** filename, int* line);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline const void* ahp_compact_at(const AHPCompact* compact, uint32_t offset)
+{
+	return (const uint8_t*)compact + offset;
+}
+
+static inline const AHPCompactSection* ahp_compact_section(const AHPCompact* compact, int index)
+{
+	return (const AHPCompactSection*)ahp_compact_at(compact, compact->sections) + index;
+}
+
+static inline const char* ahp_compact_string(const AHPCompact* compact, uint32_t offset)
+{
+	return (const char*)ahp_compact_at(compact, compact->strings + offset);
+}
+
+static inline const AHPCompactSymbol* ahp_compact_symbols(const AHPCompact* compact,
+														  const AHPCompactSection* section)
+{
+	return (const AHPCompactSymbol*)ahp_compact_at(compact, section->symbols);
+}
+
+static inline const AHPCompactLineFile* ahp_compact_line_files(const AHPCompact* compact,
+															   const AHPCompactSection* section)
+{
+	return (const AHPCompactLineFile*)ahp_compact_at(compact, section->lineFiles);
+}
+
+static inline const AHPCompactLine* ahp_compact_lines(const AHPCompact* compact, const AHPCompactLineFile* lineFile)
+{
+	return (const AHPCompactLine*)ahp_compact_at(compact, lineFile->lines);
+}
+
+static inline const AHPDebugBlock* ahp_compact_debug_blocks(const AHPCompact* compact,
+																const AHPCompactSection* section)
+{
+	return (const AHPDebugBlock*)ahp_compact_at(compact, section->debugBlocks);
+}
+
+static inline const AHPReloc* ahp_compact_relocs(const AHPCompact* compact, const AHPCompactSection* section)
+{
+	return (const AHPReloc*)ahp_compact_at(compact, section->relocs);
+}
+
+#endif
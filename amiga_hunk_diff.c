@@ -0,0 +1,429 @@
+#include "amiga_hunk_diff.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define BLOCK_SIZE 32
+#define HASH_BASE 0x01000193u
+#define MAX_DUPLICATES 8
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Match
+{
+	uint32_t a;
+	uint32_t b;
+	uint32_t size;
+
+} Match;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct MatchList
+{
+	Match* matches;
+	int count;
+	int capacity;
+
+} MatchList;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addRegion(AHPDiff* diff, AHPDiffKind kind, int sectionA, int sectionB,
+					  uint32_t offsetA, uint32_t sizeA, uint32_t offsetB, uint32_t sizeB)
+{
+	if (diff->regionCount == diff->regionCapacity)
+	{
+		diff->regionCapacity = diff->regionCapacity ? diff->regionCapacity * 2 : 16;
+		diff->regions = realloc(diff->regions, diff->regionCapacity * sizeof(AHPDiffRegion));
+	}
+
+	AHPDiffRegion* region = &diff->regions[diff->regionCount++];
+
+	region->kind = kind;
+	region->sectionA = sectionA;
+	region->sectionB = sectionB;
+	region->offsetA = offsetA;
+	region->sizeA = sizeA;
+	region->offsetB = offsetB;
+	region->sizeB = sizeB;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addMatch(MatchList* list, uint32_t a, uint32_t b, uint32_t size)
+{
+	if (list->count == list->capacity)
+	{
+		list->capacity = list->capacity ? list->capacity * 2 : 64;
+		list->matches = realloc(list->matches, list->capacity * sizeof(Match));
+	}
+
+	Match* match = &list->matches[list->count++];
+
+	match->a = a;
+	match->b = b;
+	match->size = size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Section data with all relocated bytes set to zero
+
+static uint8_t* maskedData(const AHPInfo* info, const AHPSection* section)
+{
+	const uint32_t size = (uint32_t)section->dataSize;
+	uint8_t* data = (uint8_t*)malloc(size ? size : 1);
+
+	memcpy(data, (const uint8_t*)info->fileData + section->dataStart, size);
+
+	for (int i = 0; i < section->relocCount; ++i)
+	{
+		const AHPReloc* reloc = &section->relocs[i];
+
+		if (size >= reloc->width && reloc->offset <= size - reloc->width)
+			memset(data + reloc->offset, 0, reloc->width);
+	}
+
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t commonPrefix(const uint8_t* a, const uint8_t* b, uint32_t size)
+{
+	uint32_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t va, vb;
+		memcpy(&va, a + i, 8);
+		memcpy(&vb, b + i, 8);
+
+		if (va != vb)
+			break;
+	}
+
+	while (i < size && a[i] == b[i])
+		i++;
+
+	return i;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t commonSuffix(const uint8_t* aEnd, const uint8_t* bEnd, uint32_t size)
+{
+	uint32_t i = 0;
+
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t va, vb;
+		memcpy(&va, aEnd - i - 8, 8);
+		memcpy(&vb, bEnd - i - 8, 8);
+
+		if (va != vb)
+			break;
+	}
+
+	while (i < size && aEnd[-(int64_t)i - 1] == bEnd[-(int64_t)i - 1])
+		i++;
+
+	return i;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t hashBlock(const uint8_t* data)
+{
+	uint32_t h = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; ++i)
+		h = h * HASH_BASE + data[i];
+
+	return h;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// rsync style matching: a is split into fixed blocks that go into a hash table and a rolling hash over every
+// offset of b finds blocks that still exist. Each hit is extended in both directions as far as the bytes agree.
+
+static void findMatches(MatchList* list, const uint8_t* a, uint32_t aLo, uint32_t aHi,
+						const uint8_t* b, uint32_t bLo, uint32_t bHi)
+{
+	const uint32_t blockCount = (aHi - aLo) / BLOCK_SIZE;
+	uint32_t tableSize = 16, pow = 1;
+
+	if (blockCount == 0 || bHi - bLo < BLOCK_SIZE)
+		return;
+
+	while (tableSize < blockCount * 2)
+		tableSize *= 2;
+
+	const uint32_t mask = tableSize - 1;
+	uint32_t* offsets = (uint32_t*)calloc(tableSize, sizeof(uint32_t));	// a offset + 1, 0 for an empty slot
+	uint32_t* hashes = (uint32_t*)malloc(tableSize * sizeof(uint32_t));
+
+	for (uint32_t k = 0; k < blockCount; ++k)
+	{
+		const uint32_t offset = aLo + k * BLOCK_SIZE;
+		const uint32_t h = hashBlock(a + offset);
+		uint32_t slot = h & mask;
+		int duplicates = 0;
+
+		// cap identical blocks (zero fill, padding) so lookups stay short
+
+		for (; offsets[slot] && duplicates < MAX_DUPLICATES; slot = (slot + 1) & mask)
+			duplicates += hashes[slot] == h;
+
+		if (duplicates < MAX_DUPLICATES)
+		{
+			offsets[slot] = offset + 1;
+			hashes[slot] = h;
+		}
+	}
+
+	for (int i = 0; i < BLOCK_SIZE - 1; ++i)
+		pow *= HASH_BASE;
+
+	uint32_t pos = bLo, bCursor = bLo, aCursor = aLo;
+	uint32_t h = hashBlock(b + pos);
+
+	for (;;)
+	{
+		// of the candidates prefer the one closest to where the block would be if nothing moved
+
+		const uint32_t expected = aCursor + (pos - bCursor);
+		uint32_t found = 0, bestDistance = 0xffffffff;
+
+		for (uint32_t slot = h & mask; offsets[slot]; slot = (slot + 1) & mask)
+		{
+			const uint32_t offset = offsets[slot] - 1;
+
+			if (hashes[slot] != h || memcmp(a + offset, b + pos, BLOCK_SIZE) != 0)
+				continue;
+
+			const uint32_t distance = offset > expected ? offset - expected : expected - offset;
+
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				found = offset + 1;
+			}
+		}
+
+		if (found)
+		{
+			uint32_t a0 = found - 1, b0 = pos;
+			uint32_t a1 = a0 + BLOCK_SIZE, b1 = b0 + BLOCK_SIZE;
+			const uint32_t aLimit = a0 >= aCursor ? aCursor : aLo;
+
+			while (b0 > bCursor && a0 > aLimit && a[a0 - 1] == b[b0 - 1])
+				a0--, b0--;
+
+			while (a1 < aHi && b1 < bHi && a[a1] == b[b1])
+				a1++, b1++;
+
+			addMatch(list, a0, b0, a1 - a0);
+
+			aCursor = a1;
+			bCursor = pos = b1;
+
+			if (bHi - pos < BLOCK_SIZE)
+				break;
+
+			h = hashBlock(b + pos);
+			continue;
+		}
+
+		if (bHi - pos <= BLOCK_SIZE)
+			break;
+
+		h = (h - b[pos] * pow) * HASH_BASE + b[pos + BLOCK_SIZE];
+		pos++;
+	}
+
+	free(offsets);
+	free(hashes);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addGap(AHPDiff* diff, int sa, int sb, uint32_t a0, uint32_t a1, uint32_t b0, uint32_t b1)
+{
+	if (a1 > a0 && b1 > b0)
+		addRegion(diff, AHPDiffKind_Changed, sa, sb, a0, a1 - a0, b0, b1 - b0);
+	else if (b1 > b0)
+		addRegion(diff, AHPDiffKind_Inserted, sa, sb, a0, 0, b0, b1 - b0);
+	else if (a1 > a0)
+		addRegion(diff, AHPDiffKind_Removed, sa, sb, a0, a1 - a0, b0, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void diffSection(AHPDiff* diff, const AHPInfo* infoA, int sa, const AHPInfo* infoB, int sb)
+{
+	const AHPSection* sectionA = &infoA->sections[sa];
+	const AHPSection* sectionB = &infoB->sections[sb];
+	MatchList list = { 0 };
+
+	if (sectionA->type == AHPSectionType_Bss)
+	{
+		if (sectionA->memSize != sectionB->memSize)
+			addRegion(diff, AHPDiffKind_Changed, sa, sb, 0, sectionA->memSize, 0, sectionB->memSize);
+
+		return;
+	}
+
+	const uint32_t na = (uint32_t)sectionA->dataSize;
+	const uint32_t nb = (uint32_t)sectionB->dataSize;
+	uint8_t* a = maskedData(infoA, sectionA);
+	uint8_t* b = maskedData(infoB, sectionB);
+
+	const uint32_t prefix = commonPrefix(a, b, na < nb ? na : nb);
+	const uint32_t suffix = commonSuffix(a + na, b + nb, (na < nb ? na : nb) - prefix);
+
+	const uint32_t aHi = na - suffix, bHi = nb - suffix;
+	uint32_t aCursor = prefix, bCursor = prefix;
+
+	if (aHi > prefix || bHi > prefix)
+		findMatches(&list, a, prefix, aHi, b, prefix, bHi);
+
+	for (int i = 0; i < list.count; ++i)
+	{
+		const Match* match = &list.matches[i];
+
+		if (match->a >= aCursor)
+		{
+			addGap(diff, sa, sb, aCursor, match->a, bCursor, match->b);
+			aCursor = match->a + match->size;
+		}
+		else
+		{
+			addGap(diff, sa, sb, aCursor, aCursor, bCursor, match->b);
+			addRegion(diff, AHPDiffKind_Moved, sa, sb, match->a, match->size, match->b, match->size);
+		}
+
+		bCursor = match->b + match->size;
+	}
+
+	addGap(diff, sa, sb, aCursor, aHi, bCursor, bHi);
+
+	free(list.matches);
+	free(a);
+	free(b);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPDiff* ahp_diff(const AHPInfo* a, const AHPInfo* b)
+{
+	AHPDiff* diff = (AHPDiff*)calloc(1, sizeof(AHPDiff));
+	int* paired = (int*)calloc(a->sectionCount ? a->sectionCount : 1, sizeof(int));
+
+	// the n:th section of a type in b is paired with the n:th section of the same type in a
+
+	for (int sb = 0; sb < b->sectionCount; ++sb)
+	{
+		const AHPSectionType type = b->sections[sb].type;
+		int nth = 0, sa;
+
+		for (int i = 0; i < sb; ++i)
+			nth += b->sections[i].type == type;
+
+		for (sa = 0; sa < a->sectionCount; ++sa)
+		{
+			if (a->sections[sa].type == type && nth-- == 0)
+				break;
+		}
+
+		if (sa == a->sectionCount)
+		{
+			addRegion(diff, AHPDiffKind_Inserted, -1, sb, 0, 0, 0, b->sections[sb].memSize);
+			continue;
+		}
+
+		paired[sa] = 1;
+		diffSection(diff, a, sa, b, sb);
+	}
+
+	for (int sa = 0; sa < a->sectionCount; ++sa)
+	{
+		if (!paired[sa])
+			addRegion(diff, AHPDiffKind_Removed, sa, -1, 0, a->sections[sa].memSize, 0, 0);
+	}
+
+	free(paired);
+
+	return diff;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* getKindName(AHPDiffKind kind)
+{
+	switch (kind)
+	{
+		case AHPDiffKind_Changed : return "CHANGED ";
+		case AHPDiffKind_Inserted : return "INSERTED";
+		case AHPDiffKind_Removed : return "REMOVED ";
+		case AHPDiffKind_Moved : return "MOVED   ";
+	}
+
+	return "UNKN";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printLocation(const AHPInfo* info, int sectionIndex, uint32_t offset)
+{
+	const char* filename = 0;
+	int line = 0;
+
+	if (sectionIndex < 0)
+		return;
+
+	const AHPSection* section = &info->sections[sectionIndex];
+	const AHPSymbolInfo* symbol = ahp_find_symbol(section, offset);
+
+	if (symbol)
+		printf("  %s+0x%x", symbol->name, offset - symbol->address);
+
+	if (ahp_find_line(section, offset, &filename, &line))
+		printf("  (%s:%d)", filename, line);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_diff_print(const AHPDiff* diff, const AHPInfo* a, const AHPInfo* b)
+{
+	printf("Kind      SecA  OffsetA   SizeA     SecB  OffsetB   SizeB     Location\n");
+
+	for (int i = 0; i < diff->regionCount; ++i)
+	{
+		const AHPDiffRegion* region = &diff->regions[i];
+
+		printf("%s  %4d  %08x  %8u  %4d  %08x  %8u ", getKindName(region->kind),
+				region->sectionA, region->offsetA, region->sizeA,
+				region->sectionB, region->offsetB, region->sizeB);
+
+		if (region->kind == AHPDiffKind_Removed)
+			printLocation(a, region->sectionA, region->offsetA);
+		else
+			printLocation(b, region->sectionB, region->offsetB);
+
+		printf("\n");
+	}
+
+	if (diff->regionCount == 0)
+		printf("No differences\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_diff_free(AHPDiff* diff)
+{
+	free(diff->regions);
+	free(diff);
+}
@@ -0,0 +1,53 @@
+#ifndef AMIGA_HUNK_DIFF_
+#define AMIGA_HUNK_DIFF_
+
+#include "amiga_hunk_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relocation aware diff between two executables. Sections are paired up by type and order, relocated longwords
+// are masked out on both sides (their values only move when code is inserted before the target) and the remaining
+// bytes are matched with a rolling hash so blocks that just moved aren't reported as changed.
+
+typedef enum AHPDiffKind
+{
+	AHPDiffKind_Changed,
+	AHPDiffKind_Inserted,	// only in b
+	AHPDiffKind_Removed,	// only in a
+	AHPDiffKind_Moved,		// same bytes, but out of order compared to a
+} AHPDiffKind;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPDiffRegion
+{
+	AHPDiffKind kind;
+
+	int sectionA;	// -1 if the section only exists in b
+	int sectionB;	// -1 if the section only exists in a
+
+	uint32_t offsetA;
+	uint32_t sizeA;
+	uint32_t offsetB;
+	uint32_t sizeB;
+
+} AHPDiffRegion;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPDiff
+{
+	AHPDiffRegion* regions;
+	int regionCount;
+	int regionCapacity;
+
+} AHPDiff;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPDiff* ahp_diff(const AHPInfo* a, const AHPInfo* b);
+
+// Prints the regions mapped back to symbols and source lines (b for new/changed data, a for removed data)
+void ahp_diff_print(const AHPDiff* diff, const AHPInfo* a, const AHPInfo* b);
+void ahp_diff_free(AHPDiff* diff);
+
+#endif
@@ -0,0 +1,1561 @@
+#include "amiga_hunk_elf.h"
+#include "endian.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define ELF_HEADER_SIZE 52
+#define ELF_SECTION_SIZE 40
+#define ELF_SYMBOL_SIZE 16
+#define ELF_RELA_SIZE 12
+#define ELF_REL_SIZE 8
+
+#define EM_68K 4
+#define ET_REL 1
+#define ET_EXEC 2
+
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_RELA 4
+#define SHT_NOBITS 8
+#define SHT_REL 9
+#define SHT_INIT_ARRAY 14
+#define SHT_FINI_ARRAY 15
+#define SHT_PREINIT_ARRAY 16
+
+#define SHF_ALLOC 0x2
+#define SHF_EXECINSTR 0x4
+
+#define SHN_UNDEF 0
+#define SHN_LORESERVE 0xff00
+#define SHN_ABS 0xfff1
+
+#define STT_SECTION 3
+#define STT_FILE 4
+
+#define R_68K_NONE 0
+#define R_68K_32 1
+#define R_68K_PC32 4
+#define R_68K_PC16 5
+#define R_68K_PC8 6
+
+#define DW_LNS_copy 1
+#define DW_LNS_advance_pc 2
+#define DW_LNS_advance_line 3
+#define DW_LNS_set_file 4
+#define DW_LNS_const_add_pc 8
+#define DW_LNS_fixed_advance_pc 9
+
+#define DW_LNE_end_sequence 1
+#define DW_LNE_set_address 2
+#define DW_LNE_define_file 3
+
+#define DW_LNCT_path 1
+#define DW_LNCT_directory_index 2
+
+#define DW_FORM_data2 0x05
+#define DW_FORM_data4 0x06
+#define DW_FORM_data8 0x07
+#define DW_FORM_string 0x08
+#define DW_FORM_block 0x09
+#define DW_FORM_data1 0x0b
+#define DW_FORM_strp 0x0e
+#define DW_FORM_udata 0x0f
+#define DW_FORM_data16 0x1e
+#define DW_FORM_line_strp 0x1f
+
+#define NO_HUNK -1
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct ElfSection
+{
+	uint32_t name;
+	uint32_t type;
+	uint32_t flags;
+	uint32_t addr;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t link;
+	uint32_t info;
+	int hunk;
+
+} ElfSection;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relocation inside .debug_line, used to find which hunk a DW_LNE_set_address points into in relocatable objects.
+// hunk is NO_HUNK for the string offsets of DWARF 5 headers, value is then the offset in the string section.
+
+typedef struct DebugReloc
+{
+	uint32_t offset;
+	int hunk;
+	uint32_t value;
+
+} DebugReloc;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct LineRow
+{
+	int hunk;
+	uint32_t file;
+	uint32_t address;
+	uint32_t line;
+	uint32_t order;
+
+} LineRow;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Converter
+{
+	const uint8_t* data;
+	uint32_t size;
+	int isExec;
+
+	ElfSection* sections;
+	uint32_t sectionCount;
+
+	const uint8_t* symbols;
+	uint32_t symbolCount;
+	const char* strings;
+	uint32_t stringSize;
+
+	AHPInfo* info;
+	uint8_t* hunkData;
+	uint32_t hunkDataSize;
+	uint32_t* relocCapacity;
+
+	DebugReloc* debugRelocs;
+	uint32_t debugRelocCount;
+
+	// .debug_line_str and .debug_str for DWARF 5 line tables
+	const char* lineStrings;
+	uint32_t lineStringSize;
+	const char* debugStrings;
+	uint32_t debugStringSize;
+
+	LineRow* rows;
+	uint32_t rowCount;
+	uint32_t rowCapacity;
+
+	// source files of all compile units, names that had to be joined with their directory are owned
+	const char** files;
+	uint8_t* fileOwned;
+	uint32_t fileCount;
+	uint32_t fileCapacity;
+
+} Converter;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* grow(void* data, uint32_t* capacity, uint32_t count, size_t elementSize)
+{
+	if (count < *capacity)
+		return data;
+
+	*capacity = *capacity ? *capacity * 2 : 64;
+
+	return realloc(data, *capacity * elementSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Zero terminated string at offset inside a string table, 0 if it's outside of it
+
+static const char* tableString(const char* table, uint32_t tableSize, uint32_t offset)
+{
+	if (!table || offset >= tableSize || !memchr(table + offset, 0, tableSize - offset))
+		return 0;
+
+	return table + offset;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int endsWithNoCase(const char* str, const char* suffix)
+{
+	const size_t length = strlen(str);
+	const size_t suffixLength = strlen(suffix);
+
+	if (length < suffixLength)
+		return 0;
+
+	str += length - suffixLength;
+
+	for (size_t i = 0; i < suffixLength; ++i)
+	{
+		if (tolower((unsigned char)str[i]) != suffix[i])
+			return 0;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t sectionBase(const Converter* c, const ElfSection* section)
+{
+	// addresses in relocatable objects are already relative to their section
+
+	return c->isExec ? section->addr : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int readSections(Converter* c)
+{
+	const uint32_t shoff = ahp_load_be32(c->data + 32);
+	const uint32_t shentsize = ahp_load_be16(c->data + 46);
+	const uint32_t shnum = ahp_load_be16(c->data + 48);
+	const uint32_t shstrndx = ahp_load_be16(c->data + 50);
+
+	if (shnum == 0 || shentsize < ELF_SECTION_SIZE || shoff > c->size || shnum > (c->size - shoff) / shentsize)
+	{
+		printf("Bad ELF section header table\n");
+		return 0;
+	}
+
+	c->sectionCount = shnum;
+	c->sections = (ElfSection*)calloc(shnum, sizeof(ElfSection));
+
+	for (uint32_t i = 0; i < shnum; ++i)
+	{
+		const uint8_t* sh = c->data + shoff + i * shentsize;
+		ElfSection* section = &c->sections[i];
+
+		section->name = ahp_load_be32(sh + 0);
+		section->type = ahp_load_be32(sh + 4);
+		section->flags = ahp_load_be32(sh + 8);
+		section->addr = ahp_load_be32(sh + 12);
+		section->offset = ahp_load_be32(sh + 16);
+		section->size = ahp_load_be32(sh + 20);
+		section->link = ahp_load_be32(sh + 24);
+		section->info = ahp_load_be32(sh + 28);
+		section->hunk = NO_HUNK;
+
+		if (section->type != SHT_NOBITS && (section->offset > c->size || section->size > c->size - section->offset))
+		{
+			printf("ELF section %u is outside of the file\n", i);
+			return 0;
+		}
+	}
+
+	if (shstrndx >= shnum)
+	{
+		printf("Bad ELF section name table\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* sectionName(const Converter* c, const ElfSection* section)
+{
+	const ElfSection* names = &c->sections[ahp_load_be16(c->data + 50)];
+	const char* name = tableString((const char*)c->data + names->offset, names->size, section->name);
+
+	return name ? name : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int isHunkSection(const ElfSection* section)
+{
+	if (!(section->flags & SHF_ALLOC) || section->size == 0)
+		return 0;
+
+	switch (section->type)
+	{
+		case SHT_PROGBITS:
+		case SHT_NOBITS:
+		case SHT_INIT_ARRAY:
+		case SHT_FINI_ARRAY:
+		case SHT_PREINIT_ARRAY: return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One hunk per allocated section in ELF order, the data of all CODE/DATA hunks goes into one buffer that becomes
+// info->fileData
+
+static int createHunks(Converter* c)
+{
+	uint32_t hunkCount = 0, dataSize = 0;
+
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		ElfSection* section = &c->sections[i];
+
+		if (!isHunkSection(section))
+			continue;
+
+		if (section->size > 0x7ffffff0 || (section->type != SHT_NOBITS && dataSize > 0x7ffffff0 - section->size))
+		{
+			printf("ELF section %s is too large\n", sectionName(c, section));
+			return 0;
+		}
+
+		section->hunk = (int)hunkCount++;
+
+		if (section->type != SHT_NOBITS)
+			dataSize += (section->size + 3) & ~3u;
+	}
+
+	if (hunkCount == 0 || hunkCount > 0xffff)
+	{
+		printf(hunkCount ? "Too many sections for the hunk format\n" : "No sections to convert!\n");
+		return 0;
+	}
+
+	AHPInfo* info = c->info;
+
+	info->sectionCount = (int)hunkCount;
+	info->sections = (AHPSection*)calloc(hunkCount, sizeof(AHPSection));
+	info->fileData = c->hunkData = (uint8_t*)calloc(1, dataSize ? dataSize : 1);
+
+	c->hunkDataSize = dataSize;
+	c->relocCapacity = (uint32_t*)calloc(hunkCount, sizeof(uint32_t));
+
+	dataSize = 0;
+
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		const ElfSection* elfSection = &c->sections[i];
+
+		if (elfSection->hunk == NO_HUNK)
+			continue;
+
+		AHPSection* section = &info->sections[elfSection->hunk];
+		const char* name = sectionName(c, elfSection);
+		const uint32_t alignedSize = (elfSection->size + 3) & ~3u;
+
+		if (elfSection->type == SHT_NOBITS)
+			section->type = AHPSectionType_Bss;
+		else if (elfSection->flags & SHF_EXECINSTR)
+			section->type = AHPSectionType_Code;
+		else
+			section->type = AHPSectionType_Data;
+
+		// .data_chip, .MEMF_CHIP, ... but not names that just happen to contain "chip" somewhere
+
+		if (endsWithNoCase(name, "_chip"))
+			section->target = AHPSectionTarget_Chip;
+		else if (endsWithNoCase(name, "_fast"))
+			section->target = AHPSectionTarget_Fast;
+		else
+			section->target = AHPSectionTarget_Any;
+
+		section->memSize = (int)alignedSize;
+
+		if (section->type != AHPSectionType_Bss)
+		{
+			section->dataStart = dataSize;
+			section->dataSize = (int)alignedSize;
+
+			memcpy(c->hunkData + dataSize, c->data + elfSection->offset, elfSection->size);
+			dataSize += alignedSize;
+		}
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int findSymbolTable(Converter* c)
+{
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		const ElfSection* section = &c->sections[i];
+
+		if (section->type != SHT_SYMTAB)
+			continue;
+
+		if (section->link >= c->sectionCount || c->sections[section->link].type == SHT_NOBITS)
+		{
+			printf("Bad ELF symbol table\n");
+			return 0;
+		}
+
+		const ElfSection* strings = &c->sections[section->link];
+
+		c->symbols = c->data + section->offset;
+		c->symbolCount = section->size / ELF_SYMBOL_SIZE;
+		c->strings = (const char*)c->data + strings->offset;
+		c->stringSize = strings->size;
+
+		return 1;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* symbolName(const Converter* c, uint32_t index)
+{
+	if (index >= c->symbolCount)
+		return "";
+
+	const char* name = tableString(c->strings, c->stringSize, ahp_load_be32(c->symbols + index * ELF_SYMBOL_SIZE));
+	return name ? name : "";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol value relative to the hunk it's in, hunk is NO_HUNK for absolute symbols. Returns 0 for undefined symbols
+// or symbols in sections that aren't converted.
+
+static int resolveSymbol(const Converter* c, uint32_t index, int* hunk, uint32_t* value)
+{
+	if (index >= c->symbolCount)
+		return 0;
+
+	const uint8_t* sym = c->symbols + index * ELF_SYMBOL_SIZE;
+	const uint32_t shndx = ahp_load_be16(sym + 14);
+
+	*value = ahp_load_be32(sym + 4);
+	*hunk = NO_HUNK;
+
+	if (shndx == SHN_ABS)
+		return 1;
+
+	if (shndx == SHN_UNDEF || shndx >= SHN_LORESERVE || shndx >= c->sectionCount)
+		return 0;
+
+	const ElfSection* section = &c->sections[shndx];
+
+	if (section->hunk == NO_HUNK)
+		return 0;
+
+	*hunk = section->hunk;
+	*value -= sectionBase(c, section);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addReloc(Converter* c, int hunk, uint32_t offset, uint32_t target)
+{
+	AHPSection* section = &c->info->sections[hunk];
+
+	section->relocs = (AHPReloc*)grow(section->relocs, &c->relocCapacity[hunk], (uint32_t)section->relocCount,
+									  sizeof(AHPReloc));
+
+	AHPReloc* reloc = &section->relocs[section->relocCount++];
+
+	reloc->offset = offset;
+	reloc->target = (uint16_t)target;
+	reloc->kind = AHPRelocKind_Absolute;
+	reloc->width = 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int applyRelocations(Converter* c, const ElfSection* relocSection)
+{
+	const int isRela = relocSection->type == SHT_RELA;
+	const uint32_t entrySize = isRela ? ELF_RELA_SIZE : ELF_REL_SIZE;
+	const ElfSection* target = &c->sections[relocSection->info];
+	const AHPSection* section = &c->info->sections[target->hunk];
+	const uint32_t base = sectionBase(c, target);
+	const uint8_t* entries = c->data + relocSection->offset;
+	const uint32_t count = relocSection->size / entrySize;
+
+	if (section->type == AHPSectionType_Bss)
+	{
+		printf("Relocations in BSS section %s\n", sectionName(c, target));
+		return 0;
+	}
+
+	uint8_t* data = c->hunkData + section->dataStart;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint8_t* entry = entries + i * entrySize;
+		const uint32_t offset = ahp_load_be32(entry) - base;
+		const uint32_t info = ahp_load_be32(entry + 4);
+		const uint32_t type = info & 0xff;
+		const uint32_t width = type == R_68K_PC16 ? 2 : type == R_68K_PC8 ? 1 : 4;
+		uint32_t symbolValue, addend;
+		int symbolHunk;
+
+		if (type == R_68K_NONE)
+			continue;
+
+		if (offset > target->size || width > target->size - offset)
+		{
+			printf("Relocation outside of section %s\n", sectionName(c, target));
+			return 0;
+		}
+
+		uint8_t* p = data + offset;
+
+		if (isRela)
+			addend = ahp_load_be32(entry + 8);
+		else if (width == 4)
+			addend = ahp_load_be32(p);
+		else if (width == 2)
+			addend = (uint32_t)(int16_t)ahp_load_be16(p);
+		else
+			addend = (uint32_t)(int8_t)*p;
+
+		if (!resolveSymbol(c, info >> 8, &symbolHunk, &symbolValue))
+		{
+			printf("Undefined symbol %s referenced from %s\n", symbolName(c, info >> 8), sectionName(c, target));
+			return 0;
+		}
+
+		switch (type)
+		{
+			case R_68K_32:
+			{
+				ahp_store_be32(p, symbolValue + addend);
+
+				if (symbolHunk != NO_HUNK)
+					addReloc(c, target->hunk, offset, (uint32_t)symbolHunk);
+
+				break;
+			}
+
+			case R_68K_PC32:
+			case R_68K_PC16:
+			case R_68K_PC8:
+			{
+				// the hunks are loaded at unrelated addresses so only references inside a hunk can be resolved
+
+				if (symbolHunk != target->hunk)
+				{
+					printf("PC relative reference to %s from another section in %s\n", symbolName(c, info >> 8),
+						   sectionName(c, target));
+					return 0;
+				}
+
+				const int32_t value = (int32_t)(symbolValue + addend - offset);
+
+				if ((width == 2 && (value < -32768 || value > 32767)) || (width == 1 && (value < -128 || value > 127)))
+				{
+					printf("PC relative reference to %s out of range in %s\n", symbolName(c, info >> 8),
+						   sectionName(c, target));
+					return 0;
+				}
+
+				if (width == 4)
+					ahp_store_be32(p, (uint32_t)value);
+				else if (width == 2)
+					ahp_store_be16(p, (uint16_t)value);
+				else
+					*p = (uint8_t)value;
+
+				break;
+			}
+
+			default:
+			{
+				printf("Unsupported relocation type %u in %s\n", type, sectionName(c, target));
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareSymbols(const void* a, const void* b)
+{
+	const uint32_t va = ((const AHPSymbolInfo*)a)->address;
+	const uint32_t vb = ((const AHPSymbolInfo*)b)->address;
+	return (va > vb) - (va < vb);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Section and file symbols and compiler generated local labels (.L*) are left out
+
+static int exportedSymbol(const Converter* c, uint32_t index, int* hunk, uint32_t* value)
+{
+	const uint8_t* sym = c->symbols + index * ELF_SYMBOL_SIZE;
+	const uint32_t type = sym[12] & 0xf;
+	const char* name = symbolName(c, index);
+
+	if (type == STT_SECTION || type == STT_FILE || name[0] == 0 || (name[0] == '.' && name[1] == 'L'))
+		return 0;
+
+	return resolveSymbol(c, index, hunk, value) && *hunk != NO_HUNK;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addSymbols(Converter* c)
+{
+	AHPInfo* info = c->info;
+	uint32_t value;
+	int hunk;
+
+	for (uint32_t i = 1; i < c->symbolCount; ++i)
+	{
+		if (exportedSymbol(c, i, &hunk, &value))
+			info->sections[hunk].symbolCount++;
+	}
+
+	for (int s = 0; s < info->sectionCount; ++s)
+	{
+		AHPSection* section = &info->sections[s];
+
+		if (section->symbolCount)
+			section->symbols = (AHPSymbolInfo*)malloc(section->symbolCount * sizeof(AHPSymbolInfo));
+
+		section->symbolCount = 0;
+	}
+
+	for (uint32_t i = 1; i < c->symbolCount; ++i)
+	{
+		if (!exportedSymbol(c, i, &hunk, &value))
+			continue;
+
+		AHPSymbolInfo* symbol = &info->sections[hunk].symbols[info->sections[hunk].symbolCount++];
+
+		symbol->name = symbolName(c, i);
+		symbol->address = value;
+	}
+
+	for (int s = 0; s < info->sectionCount; ++s)
+	{
+		if (info->sections[s].symbolCount)
+			qsort(info->sections[s].symbols, info->sections[s].symbolCount, sizeof(AHPSymbolInfo), compareSymbols);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t read_u8(AHPReader* reader)
+{
+	if (!reader_has(reader, 1))
+	{
+		reader_fail(reader);
+		return 0;
+	}
+
+	return reader->data[reader->index++];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t read_uleb(AHPReader* reader)
+{
+	uint32_t result = 0, shift = 0;
+	uint8_t byte;
+
+	do
+	{
+		byte = read_u8(reader);
+
+		if (shift < 32)
+			result |= (uint32_t)(byte & 0x7f) << shift;
+
+		shift += 7;
+	}
+	while (byte & 0x80);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int32_t read_sleb(AHPReader* reader)
+{
+	uint32_t result = 0, shift = 0;
+	uint8_t byte;
+
+	do
+	{
+		byte = read_u8(reader);
+
+		if (shift < 32)
+			result |= (uint32_t)(byte & 0x7f) << shift;
+
+		shift += 7;
+	}
+	while (byte & 0x80);
+
+	if (shift < 32 && (byte & 0x40))
+		result |= ~0u << shift;
+
+	return (int32_t)result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const char* read_string(AHPReader* reader)
+{
+	const char* str = tableString((const char*)reader->data, reader->size, reader->index);
+
+	if (!str)
+	{
+		reader_fail(reader);
+		return "";
+	}
+
+	reader->index += (uint32_t)strlen(str) + 1;
+
+	return str;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addFile(Converter* c, const char* name, uint32_t dir, const char** dirs, uint32_t dirCount)
+{
+	if (c->fileCount == c->fileCapacity)
+	{
+		c->fileCapacity = c->fileCapacity ? c->fileCapacity * 2 : 64;
+		c->files = (const char**)realloc(c->files, c->fileCapacity * sizeof(const char*));
+		c->fileOwned = (uint8_t*)realloc(c->fileOwned, c->fileCapacity);
+	}
+
+	// directory 0 is the compilation directory which isn't in the line table
+
+	if (dir == 0 || dir > dirCount || name[0] == '/')
+	{
+		c->files[c->fileCount] = name;
+		c->fileOwned[c->fileCount++] = 0;
+		return;
+	}
+
+	const size_t length = strlen(dirs[dir - 1]) + strlen(name) + 2;
+	char* path = (char*)malloc(length);
+
+	snprintf(path, length, "%s/%s", dirs[dir - 1], name);
+
+	c->files[c->fileCount] = path;
+	c->fileOwned[c->fileCount++] = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// file indexes the file table of the compile unit that starts at fileBase, the first entry is firstFile (1 up to
+// DWARF 4, 0 in DWARF 5)
+
+static void addRow(Converter* c, int hunk, uint32_t fileBase, uint32_t firstFile, uint32_t file, uint32_t address,
+				   uint32_t line)
+{
+	if (hunk == NO_HUNK || file < firstFile || file - firstFile >= c->fileCount - fileBase ||
+		address >= (uint32_t)c->info->sections[hunk].memSize)
+		return;
+
+	file += fileBase - firstFile;
+
+	c->rows = (LineRow*)grow(c->rows, &c->rowCapacity, c->rowCount, sizeof(LineRow));
+
+	LineRow* row = &c->rows[c->rowCount];
+
+	row->hunk = hunk;
+	row->file = file;
+	row->address = address;
+	row->line = line;
+	row->order = c->rowCount++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareDebugRelocs(const void* a, const void* b)
+{
+	const uint32_t va = ((const DebugReloc*)a)->offset;
+	const uint32_t vb = ((const DebugReloc*)b)->offset;
+	return (va > vb) - (va < vb);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void readDebugRelocs(Converter* c, uint32_t debugLineIndex)
+{
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		const ElfSection* section = &c->sections[i];
+
+		if ((section->type != SHT_RELA && section->type != SHT_REL) || section->info != debugLineIndex)
+			continue;
+
+		const int isRela = section->type == SHT_RELA;
+		const uint32_t entrySize = isRela ? ELF_RELA_SIZE : ELF_REL_SIZE;
+		const uint32_t count = section->size / entrySize;
+		const ElfSection* debugLine = &c->sections[debugLineIndex];
+
+		c->debugRelocs = (DebugReloc*)realloc(c->debugRelocs, (c->debugRelocCount + count) * sizeof(DebugReloc));
+
+		for (uint32_t r = 0; r < count; ++r)
+		{
+			const uint8_t* entry = c->data + section->offset + r * entrySize;
+			const uint32_t offset = ahp_load_be32(entry);
+			const uint32_t info = ahp_load_be32(entry + 4);
+			DebugReloc* reloc = &c->debugRelocs[c->debugRelocCount];
+			uint32_t addend;
+
+			if ((info & 0xff) != R_68K_32 || offset > debugLine->size || debugLine->size - offset < 4)
+				continue;
+
+			addend = isRela ? ahp_load_be32(entry + 8) : ahp_load_be32(c->data + debugLine->offset + offset);
+
+			// symbols outside of the hunks are kept for the string offsets in DWARF 5 headers, they point into
+			// .debug_line_str
+
+			if (!resolveSymbol(c, info >> 8, &reloc->hunk, &reloc->value) && (info >> 8) >= c->symbolCount)
+				continue;
+
+			reloc->offset = offset;
+			reloc->value += addend;
+			c->debugRelocCount++;
+		}
+	}
+
+	if (c->debugRelocCount)
+		qsort(c->debugRelocs, c->debugRelocCount, sizeof(DebugReloc), compareDebugRelocs);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const DebugReloc* findDebugReloc(const Converter* c, uint32_t offset)
+{
+	uint32_t low = 0, high = c->debugRelocCount;
+
+	while (low < high)
+	{
+		const uint32_t mid = (low + high) / 2;
+
+		if (c->debugRelocs[mid].offset < offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low == c->debugRelocCount || c->debugRelocs[low].offset != offset)
+		return 0;
+
+	return &c->debugRelocs[low];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DW_LNE_set_address operand at offset (inside .debug_line) to hunk + offset
+
+static int resolveAddress(const Converter* c, uint32_t offset, uint32_t address, uint32_t* hunkOffset)
+{
+	if (c->isExec)
+	{
+		for (uint32_t i = 0; i < c->sectionCount; ++i)
+		{
+			const ElfSection* section = &c->sections[i];
+
+			if (section->hunk != NO_HUNK && address >= section->addr && address - section->addr < section->size)
+			{
+				*hunkOffset = address - section->addr;
+				return section->hunk;
+			}
+		}
+
+		return NO_HUNK;
+	}
+
+	const DebugReloc* reloc = findDebugReloc(c, offset);
+
+	if (!reloc)
+		return NO_HUNK;
+
+	*hunkOffset = reloc->value;
+
+	return reloc->hunk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void runLineProgram(Converter* c, AHPReader* reader, uint32_t end, uint32_t fileBase, uint32_t firstFile,
+						   const uint8_t* opcodeLengths, uint8_t minLength, int8_t lineBase, uint8_t lineRange,
+						   uint8_t opcodeBase)
+{
+	uint32_t address = 0, file = 1, line = 1;
+	int hunk = NO_HUNK;
+
+	while (reader->index < end && !reader->overrun)
+	{
+		const uint8_t opcode = read_u8(reader);
+
+		if (opcode >= opcodeBase)
+		{
+			const uint32_t adjusted = opcode - opcodeBase;
+
+			address += (adjusted / lineRange) * minLength;
+			line += lineBase + (int32_t)(adjusted % lineRange);
+
+			addRow(c, hunk, fileBase, firstFile, file, address, line);
+			continue;
+		}
+
+		switch (opcode)
+		{
+			case 0:
+			{
+				const uint32_t length = read_uleb(reader);
+				const uint32_t next = reader->index + length;
+
+				if (length == 0 || length > end - reader->index)
+				{
+					reader_fail(reader);
+					return;
+				}
+
+				const uint8_t subOpcode = read_u8(reader);
+
+				if (subOpcode == DW_LNE_end_sequence)
+				{
+					address = 0;
+					file = 1;
+					line = 1;
+					hunk = NO_HUNK;
+				}
+				else if (subOpcode == DW_LNE_set_address && length == 5)
+				{
+					hunk = resolveAddress(c, reader->index, ahp_load_be32(reader->data + reader->index), &address);
+				}
+				else if (subOpcode == DW_LNE_define_file)
+				{
+					// files defined in the program are appended to the ones from the header
+
+					const char* name = read_string(reader);
+					addFile(c, name, 0, 0, 0);
+				}
+
+				reader->index = next;
+				break;
+			}
+
+			case DW_LNS_copy: addRow(c, hunk, fileBase, firstFile, file, address, line); break;
+			case DW_LNS_advance_pc: address += read_uleb(reader) * minLength; break;
+			case DW_LNS_advance_line: line += read_sleb(reader); break;
+			case DW_LNS_set_file: file = read_uleb(reader); break;
+			case DW_LNS_const_add_pc: address += ((255 - opcodeBase) / lineRange) * minLength; break;
+			case DW_LNS_fixed_advance_pc: address += get_u16_inc(reader); break;
+
+			default:
+			{
+				// skip the operands of opcodes we don't care about
+
+				for (uint8_t i = 0; i < opcodeLengths[opcode - 1]; ++i)
+					read_uleb(reader);
+
+				break;
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Offset into .debug_line_str or .debug_str stored at offset in .debug_line. In relocatable objects it's the
+// relocation against the string section that has it.
+
+static uint32_t stringOffset(const Converter* c, uint32_t offset, uint32_t stored)
+{
+	if (c->isExec)
+		return stored;
+
+	const DebugReloc* reloc = findDebugReloc(c, offset);
+
+	return reloc && reloc->hunk == NO_HUNK ? reloc->value : stored;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Attribute of a DWARF 5 directory or file entry, str is set for the string forms
+
+static uint32_t readForm(const Converter* c, AHPReader* reader, uint32_t form, const char** str)
+{
+	uint32_t value = 0;
+
+	*str = 0;
+
+	switch (form)
+	{
+		case DW_FORM_string: *str = read_string(reader); break;
+		case DW_FORM_data1: value = read_u8(reader); break;
+		case DW_FORM_data2: value = get_u16_inc(reader); break;
+		case DW_FORM_data4: value = get_u32_inc(reader); break;
+		case DW_FORM_data8: reader_skip(reader, 8); break;
+		case DW_FORM_data16: reader_skip(reader, 16); break;
+		case DW_FORM_udata: value = read_uleb(reader); break;
+		case DW_FORM_block: reader_skip(reader, read_uleb(reader)); break;
+
+		case DW_FORM_strp:
+		case DW_FORM_line_strp:
+		{
+			const uint32_t offset = reader->index;
+
+			value = stringOffset(c, offset, get_u32_inc(reader));
+
+			if (form == DW_FORM_strp)
+				*str = tableString(c->debugStrings, c->debugStringSize, value);
+			else
+				*str = tableString(c->lineStrings, c->lineStringSize, value);
+
+			if (!*str)
+				*str = "";
+
+			break;
+		}
+
+		default: reader_fail(reader); break;
+	}
+
+	return value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// DWARF 5 describes the directory and file entries with a list of (content type, form) pairs
+
+typedef struct EntryFormat
+{
+	uint32_t count;
+	uint32_t types[16];
+	uint32_t forms[16];
+
+} EntryFormat;
+
+static void readEntryFormat(AHPReader* reader, EntryFormat* format)
+{
+	format->count = read_u8(reader);
+
+	if (format->count > sizeof(format->types) / sizeof(format->types[0]))
+	{
+		format->count = 0;
+		reader_fail(reader);
+		return;
+	}
+
+	for (uint32_t i = 0; i < format->count; ++i)
+	{
+		format->types[i] = read_uleb(reader);
+		format->forms[i] = read_uleb(reader);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void readEntry(const Converter* c, AHPReader* reader, const EntryFormat* format, const char** path,
+					  uint32_t* dir)
+{
+	*path = "";
+	*dir = 0;
+
+	for (uint32_t i = 0; i < format->count; ++i)
+	{
+		const char* str;
+		const uint32_t value = readForm(c, reader, format->forms[i], &str);
+
+		if (format->types[i] == DW_LNCT_path && str)
+			*path = str;
+		else if (format->types[i] == DW_LNCT_directory_index)
+			*dir = value;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Directory and file tables up to DWARF 4, both zero terminated
+
+static void readFiles(Converter* c, AHPReader* reader, uint32_t programStart)
+{
+	const char* dirs[256];
+	uint32_t dirCount = 0;
+
+	while (reader->index < programStart && reader->data[reader->index] != 0)
+	{
+		const char* dir = read_string(reader);
+
+		if (dirCount < sizeof(dirs) / sizeof(dirs[0]))
+			dirs[dirCount++] = dir;
+	}
+
+	reader_skip(reader, 1);
+
+	while (reader->index < programStart && reader->data[reader->index] != 0)
+	{
+		const char* name = read_string(reader);
+		const uint32_t dir = read_uleb(reader);
+
+		read_uleb(reader); // modification time
+		read_uleb(reader); // length
+
+		addFile(c, name, dir, dirs, dirCount);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Directory and file tables in DWARF 5, counted and with the compilation directory as directory 0
+
+static void readFilesV5(Converter* c, AHPReader* reader)
+{
+	const char* dirs[256];
+	uint32_t dirCount = 0;
+	EntryFormat format;
+
+	readEntryFormat(reader, &format);
+	uint32_t count = read_uleb(reader);
+
+	for (uint32_t i = 0; i < count && format.count && !reader->overrun; ++i)
+	{
+		const char* path;
+		uint32_t dir;
+
+		readEntry(c, reader, &format, &path, &dir);
+
+		if (dirCount < sizeof(dirs) / sizeof(dirs[0]))
+			dirs[dirCount++] = path;
+	}
+
+	readEntryFormat(reader, &format);
+	count = read_uleb(reader);
+
+	for (uint32_t i = 0; i < count && format.count && !reader->overrun; ++i)
+	{
+		const char* path;
+		uint32_t dir;
+
+		readEntry(c, reader, &format, &path, &dir);
+
+		// names in the compilation directory stay relative like they are up to DWARF 4
+
+		if (dirCount)
+			addFile(c, path, dir, dirs + 1, dirCount - 1);
+		else
+			addFile(c, path, 0, 0, 0);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void readLineTable(Converter* c, const ElfSection* section)
+{
+	AHPReader reader;
+
+	reader_init(&reader, c->data + section->offset, section->size);
+
+	while (reader_has(&reader, 4) && !reader.overrun)
+	{
+		const uint32_t unitLength = get_u32_inc(&reader);
+
+		// 64-bit DWARF isn't used for m68k
+
+		if (unitLength >= 0xfffffff0 || !reader_has(&reader, unitLength))
+			return;
+
+		const uint32_t end = reader.index + unitLength;
+		const uint16_t version = get_u16_inc(&reader);
+
+		if (version < 2 || version > 5)
+		{
+			printf("Skipping DWARF %u line table, only versions 2 to 5 are supported\n", version);
+			reader_seek(&reader, end);
+			continue;
+		}
+
+		if (version >= 5)
+		{
+			read_u8(&reader); // address_size
+			read_u8(&reader); // segment_selector_size
+		}
+
+		const uint32_t headerLength = get_u32_inc(&reader);
+
+		if (headerLength > end - reader.index)
+		{
+			reader_seek(&reader, end);
+			continue;
+		}
+
+		const uint32_t programStart = reader.index + headerLength;
+		const uint8_t minLength = read_u8(&reader);
+
+		if (version >= 4)
+			read_u8(&reader); // maximum_operations_per_instruction, always 1 for non VLIW
+
+		read_u8(&reader); // default_is_stmt
+		const int8_t lineBase = (int8_t)read_u8(&reader);
+		const uint8_t lineRange = read_u8(&reader);
+		const uint8_t opcodeBase = read_u8(&reader);
+		const uint8_t* opcodeLengths = reader.data + reader.index;
+
+		if (lineRange == 0 || opcodeBase == 0)
+		{
+			reader_seek(&reader, end);
+			continue;
+		}
+
+		reader_skip(&reader, opcodeBase - 1);
+
+		const uint32_t fileBase = c->fileCount;
+
+		if (version >= 5)
+			readFilesV5(c, &reader);
+		else
+			readFiles(c, &reader, programStart);
+
+		if (reader.overrun)
+			return;
+
+		reader_seek(&reader, programStart);
+
+		runLineProgram(c, &reader, end, fileBase, version >= 5 ? 0 : 1, opcodeLengths, minLength, lineBase, lineRange,
+					   opcodeBase);
+
+		reader.overrun = 0;
+		reader_seek(&reader, end);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareRowAddresses(const void* a, const void* b)
+{
+	const LineRow* ra = (const LineRow*)a;
+	const LineRow* rb = (const LineRow*)b;
+
+	if (ra->address != rb->address)
+		return ra->address < rb->address ? -1 : 1;
+
+	return (ra->order > rb->order) - (ra->order < rb->order);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void countingSort(const LineRow* in, LineRow* out, uint32_t count, uint32_t* offsets, uint32_t keyCount,
+						 int byHunk)
+{
+	memset(offsets, 0, (keyCount + 1) * sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < count; ++i)
+		offsets[(byHunk ? (uint32_t)in[i].hunk : in[i].file) + 1]++;
+
+	for (uint32_t k = 1; k <= keyCount; ++k)
+		offsets[k] += offsets[k - 1];
+
+	for (uint32_t i = 0; i < count; ++i)
+		out[offsets[byHunk ? (uint32_t)in[i].hunk : in[i].file]++] = in[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sorts the rows by hunk, file and address. The line programs emit rows in address order within each sequence so a
+// stable counting sort on file and then on hunk normally leaves every group sorted already, groups that aren't
+// (sequences out of order) are sorted on their own.
+
+static void sortRows(Converter* c)
+{
+	const uint32_t hunkCount = (uint32_t)c->info->sectionCount;
+	const uint32_t keyCount = c->fileCount > hunkCount ? c->fileCount : hunkCount;
+	LineRow* temp = (LineRow*)malloc(c->rowCount * sizeof(LineRow));
+	uint32_t* offsets = (uint32_t*)malloc((keyCount + 1) * sizeof(uint32_t));
+	uint32_t i = 0;
+
+	countingSort(c->rows, temp, c->rowCount, offsets, c->fileCount, 0);
+	countingSort(temp, c->rows, c->rowCount, offsets, hunkCount, 1);
+
+	free(offsets);
+	free(temp);
+
+	while (i < c->rowCount)
+	{
+		const LineRow* first = &c->rows[i];
+		uint32_t n = 1, sorted = 1;
+
+		for (; i + n < c->rowCount && c->rows[i + n].hunk == first->hunk && c->rows[i + n].file == first->file; ++n)
+			sorted &= c->rows[i + n].address >= c->rows[i + n - 1].address;
+
+		if (!sorted)
+			qsort(&c->rows[i], n, sizeof(LineRow), compareRowAddresses);
+
+		i += n;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Rows are grouped into one AHPLineInfo per hunk and file. When several rows have the same address the last one wins.
+
+static void addLineInfo(Converter* c)
+{
+	AHPInfo* info = c->info;
+	uint32_t i = 0;
+
+	if (c->rowCount == 0)
+		return;
+
+	sortRows(c);
+
+	while (i < c->rowCount)
+	{
+		const LineRow* first = &c->rows[i];
+		uint32_t n = 1;
+
+		while (i + n < c->rowCount && c->rows[i + n].hunk == first->hunk && c->rows[i + n].file == first->file)
+			n++;
+
+		AHPSection* section = &info->sections[first->hunk];
+
+		section->debugLines = (AHPLineInfo*)realloc(section->debugLines,
+													(section->debugLineCount + 1) * sizeof(AHPLineInfo));
+
+		AHPLineInfo* lineInfo = &section->debugLines[section->debugLineCount++];
+
+		lineInfo->filename = c->files[first->file];
+		lineInfo->baseOffset = 0;
+		lineInfo->addresses = (uint32_t*)malloc(n * sizeof(uint32_t));
+		lineInfo->lines = (int*)malloc(n * sizeof(int));
+		lineInfo->count = 0;
+
+		for (uint32_t r = 0; r < n; ++r)
+		{
+			const LineRow* row = &first[r];
+
+			if (r + 1 < n && first[r + 1].address == row->address)
+				continue;
+
+			lineInfo->addresses[lineInfo->count] = row->address;
+			lineInfo->lines[lineInfo->count++] = (int)row->line;
+		}
+
+		i += n;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const ElfSection* findDebugSection(const Converter* c, const char* name)
+{
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		const ElfSection* section = &c->sections[i];
+
+		if (section->type == SHT_PROGBITS && strcmp(sectionName(c, section), name) == 0)
+			return section;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void readDebugLines(Converter* c)
+{
+	const ElfSection* section = findDebugSection(c, ".debug_line");
+	const ElfSection* lineStrings = findDebugSection(c, ".debug_line_str");
+	const ElfSection* debugStrings = findDebugSection(c, ".debug_str");
+
+	if (!section)
+		return;
+
+	if (lineStrings)
+	{
+		c->lineStrings = (const char*)c->data + lineStrings->offset;
+		c->lineStringSize = lineStrings->size;
+	}
+
+	if (debugStrings)
+	{
+		c->debugStrings = (const char*)c->data + debugStrings->offset;
+		c->debugStringSize = debugStrings->size;
+	}
+
+	if (!c->isExec)
+		readDebugRelocs(c, (uint32_t)(section - c->sections));
+
+	readLineTable(c, section);
+	addLineInfo(c);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol names and filenames point into the ELF data while converting. They are copied behind the section data in
+// info->fileData at the end so the result doesn't depend on the input buffer (same as for parsed files).
+
+static void copyStrings(Converter* c)
+{
+	AHPInfo* info = c->info;
+	uint32_t stringSize = 0;
+
+	for (int s = 0; s < info->sectionCount; ++s)
+	{
+		const AHPSection* section = &info->sections[s];
+
+		for (int i = 0; i < section->symbolCount; ++i)
+			stringSize += (uint32_t)strlen(section->symbols[i].name) + 1;
+
+		for (int i = 0; i < section->debugLineCount; ++i)
+			stringSize += (uint32_t)strlen(section->debugLines[i].filename) + 1;
+	}
+
+	uint8_t* data = (uint8_t*)realloc(c->hunkData, c->hunkDataSize + stringSize + 1);
+	char* strings = (char*)data + c->hunkDataSize;
+
+	info->fileData = c->hunkData = data;
+
+	for (int s = 0; s < info->sectionCount; ++s)
+	{
+		AHPSection* section = &info->sections[s];
+
+		for (int i = 0; i < section->symbolCount; ++i)
+		{
+			const size_t length = strlen(section->symbols[i].name) + 1;
+			memcpy(strings, section->symbols[i].name, length);
+			section->symbols[i].name = strings;
+			strings += length;
+		}
+
+		for (int i = 0; i < section->debugLineCount; ++i)
+		{
+			const size_t length = strlen(section->debugLines[i].filename) + 1;
+			memcpy(strings, section->debugLines[i].filename, length);
+			section->debugLines[i].filename = strings;
+			strings += length;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Executables only keep their relocations when linked with --emit-relocs, without them there is nothing to tell
+// addresses from other values and the hunks would load at the wrong place
+
+static int hasRelocations(const Converter* c)
+{
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		if (c->sections[i].type == SHT_RELA || c->sections[i].type == SHT_REL)
+			return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int convert(Converter* c)
+{
+	const uint8_t* ident = c->data;
+
+	if (c->size < ELF_HEADER_SIZE || memcmp(ident, "\177ELF", 4) != 0)
+	{
+		printf("Not an ELF file\n");
+		return 0;
+	}
+
+	const uint16_t type = ahp_load_be16(c->data + 16);
+
+	if (ident[4] != 1 || ident[5] != 2 || ahp_load_be16(c->data + 18) != EM_68K || (type != ET_REL && type != ET_EXEC))
+	{
+		printf("Only 32-bit big endian m68k relocatable or executable ELF files are supported\n");
+		return 0;
+	}
+
+	c->isExec = type == ET_EXEC;
+
+	if (!readSections(c))
+		return 0;
+
+	if (c->isExec && !hasRelocations(c))
+	{
+		printf("Executable has no relocations, it has to be linked with --emit-relocs\n");
+		return 0;
+	}
+
+	if (!createHunks(c) || !findSymbolTable(c))
+		return 0;
+
+	for (uint32_t i = 0; i < c->sectionCount; ++i)
+	{
+		const ElfSection* section = &c->sections[i];
+
+		if ((section->type != SHT_RELA && section->type != SHT_REL) || section->info >= c->sectionCount ||
+			c->sections[section->info].hunk == NO_HUNK)
+			continue;
+
+		if (!applyRelocations(c, section))
+			return 0;
+	}
+
+	addSymbols(c);
+	readDebugLines(c);
+	copyStrings(c);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPInfo* ahp_elf_convert(const void* data, size_t size)
+{
+	Converter c;
+
+	if (size > UINT32_MAX)
+	{
+		printf("ELF file is too large\n");
+		return 0;
+	}
+
+	memset(&c, 0, sizeof(c));
+
+	c.data = (const uint8_t*)data;
+	c.size = (uint32_t)size;
+	c.info = (AHPInfo*)calloc(1, sizeof(AHPInfo));
+
+	const int result = convert(&c);
+
+	for (uint32_t i = 0; i < c.fileCount; ++i)
+	{
+		if (c.fileOwned[i])
+			free((void*)c.files[i]);
+	}
+
+	free(c.files);
+	free(c.fileOwned);
+	free(c.rows);
+	free(c.debugRelocs);
+	free(c.relocCapacity);
+	free(c.sections);
+
+	if (!result)
+	{
+		ahp_free(c.info);
+		return 0;
+	}
+
+	return c.info;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPInfo* ahp_elf_load(const char* filename)
+{
+	FILE* f = fopen(filename, "rb");
+	AHPInfo* info = 0;
+
+	if (!f)
+	{
+		printf("Unable to open %s\n", filename);
+		return 0;
+	}
+
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	void* data = size > 0 ? malloc((size_t)size) : 0;
+
+	if (data && fread(data, 1, (size_t)size, f) == (size_t)size)
+		info = ahp_elf_convert(data, (size_t)size);
+	else
+		printf("Unable to read %s\n", filename);
+
+	free(data);
+	fclose(f);
+
+	return info;
+}
@@ -0,0 +1,20 @@
+#ifndef AMIGA_HUNK_ELF_
+#define AMIGA_HUNK_ELF_
+
+#include "amiga_hunk_parser.h"
+#include <stddef.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Converts m68k ELF files (relocatable objects, or executables linked with --emit-relocs) to an AHPInfo that can be
+// written with amiga_hunk_writer.h. Every allocated section with contents becomes a hunk: CODE if executable, BSS if
+// it has no file data and DATA otherwise. Sections with names ending in _chip or _fast (.data_chip, .MEMF_FAST, ...)
+// get that memory target.
+//
+// R_68K_32 relocations become 32-bit absolute relocations with S + A (relative to the target hunk) stored in the
+// data, PC relative relocations are resolved when they stay inside a hunk. Symbols from .symtab become HUNK_SYMBOL
+// entries and .debug_line (DWARF 2 to 5) becomes LINE debug info, one block per hunk and source file.
+
+AHPInfo* ahp_elf_convert(const void* data, size_t size);
+AHPInfo* ahp_elf_load(const char* filename);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef AMIGA_HUNK_INDEX_
+#define AMIGA_HUNK_INDEX_
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// On-disk inverted index written by "ahp_index scan" over a tree of executables. The file is meant to be mmapped and
+// used as is so everything is in host byte order and every table is aligned to 8 bytes.
+//
+// Layout: AHPIndexHeader, files, symbols, postings, sections, hashes, strings. All table positions in the header
+// are byte offsets from the start of the file, all names are byte offsets into the string table.
+
+#define AHP_INDEX_MAGIC 0x41485049 // 'AHPI'
+#define AHP_INDEX_VERSION 1
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPIndexHeader
+{
+	uint32_t magic;
+	uint32_t version;
+
+	uint32_t fileCount;
+	uint32_t symbolCount;
+	uint32_t postingCount;
+	uint32_t sectionCount;
+
+	uint64_t filesOffset;
+	uint64_t symbolsOffset;
+	uint64_t postingsOffset;
+	uint64_t sectionsOffset;
+	uint64_t hashesOffset;
+	uint64_t stringsOffset;
+	uint64_t stringSize;
+
+} AHPIndexHeader;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Files are sorted by path, the index in this table is the file id used everywhere else
+
+typedef struct AHPIndexFile
+{
+	uint32_t path;
+	uint32_t firstSection;
+	uint32_t sectionCount;
+	uint32_t symbolCount;
+
+} AHPIndexFile;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Unique symbol names sorted with strcmp, each with a posting list of the ids of the files that define it
+
+typedef struct AHPIndexSymbol
+{
+	uint32_t name;
+	uint32_t firstPosting;
+	uint32_t postingCount;
+
+} AHPIndexSymbol;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sections of all files in file order, hash is ahp_section_hash
+
+typedef struct AHPIndexSection
+{
+	uint64_t hash;
+	uint32_t memSize;
+	uint16_t type;		// AHPSectionType
+	uint16_t target;	// AHPSectionTarget
+
+} AHPIndexSection;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// All sections sorted by hash for lookups, section is an index into the section table
+
+typedef struct AHPIndexHash
+{
+	uint64_t hash;
+	uint32_t file;
+	uint32_t section;
+
+} AHPIndexHash;
+
+#endif
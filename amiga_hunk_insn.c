@@ -0,0 +1,720 @@
+#include "amiga_hunk_insn.h"
+#include "endian.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#define AHP_INSN_THREADS
+#endif
+
+#define MAX_BUILD_THREADS 64
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int highestBit(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return 31 - __builtin_clz(val);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, val);
+	return (int)index;
+#else
+	int bit = 31;
+	while (!(val & (1u << bit)))
+		bit--;
+	return bit;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int lowestBit(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(val);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, val);
+	return (int)index;
+#else
+	int bit = 0;
+	while (!(val & (1u << bit)))
+		bit++;
+	return bit;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Size of the (d8,An,Xn) / (d8,PC,Xn) extension. On 68020 bit 8 selects the full format with base and outer
+// displacements.
+
+static int indexLength(const uint8_t* ext, uint32_t avail, AHPCpu cpu)
+{
+	if (avail < 2)
+		return -1;
+
+	const uint16_t word = ahp_load_be16(ext);
+
+	if (cpu == AHPCpu_68000 || !(word & 0x100))
+		return 2;
+
+	const int bdSize = (word >> 4) & 3;
+	const int iis = word & 7;
+	int len = 2;
+
+	switch (bdSize)
+	{
+		case 0: return -1;
+		case 2: len += 2; break;
+		case 3: len += 4; break;
+	}
+
+	if (iis == 4 || ((word & 0x40) && iis > 3))
+		return -1;
+
+	switch (iis & 3)
+	{
+		case 2: len += 2; break;
+		case 3: len += 4; break;
+	}
+
+	return len;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Size of the extension words for an effective address, -1 if the mode is invalid. imm is the size of an immediate
+// operand for the instruction.
+
+static int eaLength(const uint8_t* ext, uint32_t avail, int mode, int reg, int imm, AHPCpu cpu)
+{
+	switch (mode)
+	{
+		case 0: case 1: case 2: case 3: case 4: return 0;
+		case 5: return 2;
+		case 6: return indexLength(ext, avail, cpu);
+	}
+
+	switch (reg)
+	{
+		case 0: return 2;
+		case 1: return 4;
+		case 2: return 2;
+		case 3: return indexLength(ext, avail, cpu);
+		case 4: return imm;
+	}
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int withEa(const uint8_t* op, uint32_t avail, int base, int mode, int reg, int imm, AHPCpu cpu)
+{
+	if ((uint32_t)base > avail)
+		return -1;
+
+	const int ea = eaLength(op + base, avail - base, mode, reg, imm, cpu);
+
+	return ea < 0 ? -1 : base + ea;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int immSize(int size)
+{
+	return size == 2 ? 4 : 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int lengthLine0(const uint8_t* p, uint32_t avail, uint16_t op, int mode, int reg, AHPCpu cpu)
+{
+	const int kind = (op >> 9) & 7;
+	const int size = (op >> 6) & 3;
+	const int is020 = cpu == AHPCpu_68020;
+
+	if (op & 0x100)
+	{
+		if (mode == 1)
+			return 4;  // MOVEP
+
+		return withEa(p, avail, 2, mode, reg, 2, cpu);  // BTST/BCHG/BCLR/BSET Dn
+	}
+
+	if (kind == 4)
+		return withEa(p, avail, 4, mode, reg, 2, cpu);  // BTST/BCHG/BCLR/BSET #
+
+	if (kind == 7)
+	{
+		if (size != 3)
+			return is020 && mode >= 2 ? withEa(p, avail, 4, mode, reg, 0, cpu) : -1;  // MOVES (68010 and later)
+
+		if (!is020)
+			return -1;
+
+		return op == 0x0EFC ? 6 : withEa(p, avail, 4, mode, reg, 0, cpu);  // CAS2.L / CAS.L
+	}
+
+	if (size == 3)
+	{
+		if (!is020)
+			return -1;
+
+		switch (kind)
+		{
+			case 0: case 1: case 2: return withEa(p, avail, 4, mode, reg, 0, cpu);  // CHK2/CMP2
+			case 3: return mode <= 1 ? 2 : withEa(p, avail, 4, mode, reg, 0, cpu);  // RTM / CALLM
+			case 5: case 6: return op == 0x0CFC ? 6 : withEa(p, avail, 4, mode, reg, 0, cpu);  // CAS2.W / CAS
+		}
+
+		return -1;
+	}
+
+	// ORI/ANDI/SUBI/ADDI/EORI/CMPI
+
+	if (mode == 7 && reg == 4)
+		return size < 2 ? 4 : -1;  // to CCR/SR
+
+	return withEa(p, avail, 2 + immSize(size), mode, reg, 0, cpu);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int lengthLine4(const uint8_t* p, uint32_t avail, uint16_t op, int mode, int reg, AHPCpu cpu)
+{
+	const int size = (op >> 6) & 3;
+	const int is020 = cpu == AHPCpu_68020;
+
+	switch (op)
+	{
+		case 0x4AFC: // ILLEGAL
+		case 0x4E70: // RESET
+		case 0x4E71: // NOP
+		case 0x4E73: // RTE
+		case 0x4E75: // RTS
+		case 0x4E76: // TRAPV
+		case 0x4E77: // RTR
+			return 2;
+
+		case 0x4E72: // STOP
+			return 4;
+
+		case 0x4E74: // RTD (68010 and later)
+		case 0x4E7A: // MOVEC (68010 and later)
+		case 0x4E7B:
+			return is020 ? 4 : -1;
+	}
+
+	if ((op & 0xFFF0) == 0x4E40 || (op & 0xFFF0) == 0x4E60 || (op & 0xFFF8) == 0x4E58)
+		return 2;  // TRAP, MOVE USP, UNLK
+
+	if ((op & 0xFFF8) == 0x4E50)
+		return 4;  // LINK.W
+
+	if ((op & 0xFF80) == 0x4E80)
+		return withEa(p, avail, 2, mode, reg, 0, cpu);  // JSR/JMP
+
+	if ((op & 0xFFF8) == 0x4808)
+		return is020 ? 6 : -1;  // LINK.L
+
+	if ((op & 0xFFF0) == 0x4840)
+		return 2;  // SWAP, BKPT
+
+	if ((op & 0xFFB8) == 0x4880 || (op & 0xFFF8) == 0x49C0)
+		return 2;  // EXT.W, EXT.L, EXTB.L
+
+	if ((op & 0xFB80) == 0x4880)
+		return withEa(p, avail, 4, mode, reg, 0, cpu);  // MOVEM
+
+	if ((op & 0xFF80) == 0x4C00)
+		return is020 ? withEa(p, avail, 4, mode, reg, 4, cpu) : -1;  // MULx.L / DIVx.L
+
+	if ((op & 0x01C0) == 0x01C0)
+		return withEa(p, avail, 2, mode, reg, 0, cpu);  // LEA
+
+	if ((op & 0x0140) == 0x0100)
+		return withEa(p, avail, 2, mode, reg, (op & 0x80) ? 2 : 4, cpu);  // CHK
+
+	switch ((op >> 8) & 0xF)
+	{
+		case 0x0: // NEGX, MOVE from SR
+		case 0x2: // CLR, MOVE from CCR
+		case 0x4: // NEG, MOVE to CCR
+		case 0x6: // NOT, MOVE to SR
+			return withEa(p, avail, 2, mode, reg, size == 3 ? 2 : immSize(size), cpu);
+
+		case 0x8: // NBCD, PEA
+			return withEa(p, avail, 2, mode, reg, 2, cpu);
+
+		case 0xA: // TST, TAS
+			return withEa(p, avail, 2, mode, reg, size == 3 ? 2 : immSize(size), cpu);
+	}
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 68881/68882 (coprocessor id 1)
+
+static int lengthFpu(const uint8_t* p, uint32_t avail, uint16_t op, int mode, int reg, AHPCpu cpu)
+{
+	static const int formatSize[8] = { 4, 4, 12, 12, 2, 8, 2, -1 };
+
+	if (cpu != AHPCpu_68020 || ((op >> 9) & 7) != 1)
+		return -1;
+
+	switch ((op >> 6) & 7)
+	{
+		case 0: // general
+		{
+			if (avail < 4)
+				return -1;
+
+			const uint16_t cmd = ahp_load_be16(p + 2);
+			const int opclass = (cmd >> 13) & 7;
+			const int format = (cmd >> 10) & 7;
+
+			switch (opclass)
+			{
+				case 0: return 4;
+				case 1: return -1;
+				case 2: return format == 7 ? 4 : withEa(p, avail, 4, mode, reg, formatSize[format], cpu);
+				case 3: return withEa(p, avail, 4, mode, reg, 0, cpu);
+			}
+
+			return withEa(p, avail, 4, mode, reg, 4, cpu);  // FMOVE(M) control registers, FMOVEM
+		}
+
+		case 1: // FScc, FDBcc, FTRAPcc
+		{
+			if (mode == 1)
+				return 6;
+
+			if (mode == 7 && reg >= 2 && reg <= 4)
+				return reg == 2 ? 6 : reg == 3 ? 8 : 4;
+
+			return withEa(p, avail, 4, mode, reg, 0, cpu);
+		}
+
+		case 2: return 4; // FBcc.W
+		case 3: return 6; // FBcc.L
+		case 4: // FSAVE
+		case 5: // FRESTORE
+			return withEa(p, avail, 2, mode, reg, 0, cpu);
+	}
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_insn_length(const uint8_t* code, uint32_t size, uint32_t offset, AHPCpu cpu)
+{
+	if (offset >= size || size - offset < 2)
+		return 0;
+
+	const uint8_t* p = code + offset;
+	const uint32_t avail = size - offset;
+	const uint16_t op = ahp_load_be16(p);
+	const int mode = (op >> 3) & 7;
+	const int reg = op & 7;
+	const int opmode = (op >> 6) & 7;
+	int len = -1;
+
+	switch (op >> 12)
+	{
+		case 0x0: len = lengthLine0(p, avail, op, mode, reg, cpu); break;
+
+		case 0x1: // MOVE.B
+		case 0x2: // MOVE.L, MOVEA.L
+		case 0x3: // MOVE.W, MOVEA.W
+		{
+			const int imm = (op >> 12) == 2 ? 4 : 2;
+			const int destMode = (op >> 6) & 7;
+			const int destReg = (op >> 9) & 7;
+
+			// the destination has to be alterable (no PC relative or immediate) and MOVEA has no byte size
+
+			if ((destMode == 7 && destReg >= 2) || (destMode == 1 && (op >> 12) == 1))
+				break;
+
+			const int src = withEa(p, avail, 2, mode, reg, imm, cpu);
+
+			if (src >= 0)
+				len = withEa(p, avail, src, destMode, destReg, 0, cpu);
+
+			break;
+		}
+
+		case 0x4: len = lengthLine4(p, avail, op, mode, reg, cpu); break;
+
+		case 0x5:
+		{
+			if (opmode != 3 && opmode != 7)
+				len = withEa(p, avail, 2, mode, reg, 0, cpu);  // ADDQ/SUBQ
+			else if (mode == 1)
+				len = 4;  // DBcc
+			else if (mode == 7 && reg >= 2 && reg <= 4)
+				len = cpu == AHPCpu_68020 ? (reg == 2 ? 4 : reg == 3 ? 6 : 2) : -1;  // TRAPcc
+			else
+				len = withEa(p, avail, 2, mode, reg, 0, cpu);  // Scc
+
+			break;
+		}
+
+		case 0x6: // Bcc, BRA, BSR
+		{
+			switch (op & 0xFF)
+			{
+				case 0x00: len = 4; break;
+				case 0xFF: len = cpu == AHPCpu_68020 ? 6 : 2; break;
+				default: len = 2; break;
+			}
+
+			break;
+		}
+
+		case 0x7: len = (op & 0x100) ? -1 : 2; break; // MOVEQ
+
+		case 0x8:
+		{
+			if (opmode == 3 || opmode == 7)
+				len = withEa(p, avail, 2, mode, reg, 2, cpu);  // DIVU.W/DIVS.W
+			else if ((op & 0x1F0) == 0x100)
+				len = 2;  // SBCD
+			else if ((op & 0x1F0) == 0x140 || (op & 0x1F0) == 0x180)
+				len = cpu == AHPCpu_68020 ? 4 : -1;  // PACK/UNPK
+			else
+				len = withEa(p, avail, 2, mode, reg, immSize(opmode & 3), cpu);  // OR
+
+			break;
+		}
+
+		case 0x9: // SUB, SUBA, SUBX
+		case 0xD: // ADD, ADDA, ADDX
+		{
+			if (opmode == 3 || opmode == 7)
+				len = withEa(p, avail, 2, mode, reg, opmode == 3 ? 2 : 4, cpu);
+			else if ((op & 0x130) == 0x100)
+				len = 2;
+			else
+				len = withEa(p, avail, 2, mode, reg, immSize(opmode & 3), cpu);
+
+			break;
+		}
+
+		case 0xB: // CMP, CMPA, CMPM, EOR
+		{
+			if (opmode == 3 || opmode == 7)
+				len = withEa(p, avail, 2, mode, reg, opmode == 3 ? 2 : 4, cpu);
+			else if ((op & 0x138) == 0x108)
+				len = 2;
+			else
+				len = withEa(p, avail, 2, mode, reg, immSize(opmode & 3), cpu);
+
+			break;
+		}
+
+		case 0xC: // AND, MULU.W/MULS.W, ABCD, EXG
+		{
+			if (opmode == 3 || opmode == 7)
+				len = withEa(p, avail, 2, mode, reg, 2, cpu);
+			else if ((op & 0x130) == 0x100)
+				len = 2;
+			else
+				len = withEa(p, avail, 2, mode, reg, immSize(opmode & 3), cpu);
+
+			break;
+		}
+
+		case 0xE: // shifts, rotates and 68020 bit fields
+		{
+			if ((opmode & 3) != 3)
+				len = 2;
+			else if (op & 0x800)
+				len = cpu == AHPCpu_68020 ? withEa(p, avail, 4, mode, reg, 0, cpu) : -1;
+			else
+				len = withEa(p, avail, 2, mode, reg, 0, cpu);
+
+			break;
+		}
+
+		case 0xF: len = lengthFpu(p, avail, op, mode, reg, cpu); break;
+	}
+
+	// line A and the invalid encodings above end up here
+
+	if (len <= 0 || (uint32_t)len > avail)
+		return 0;
+
+	return len;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void markStart(uint32_t* starts, uint32_t offset)
+{
+	offset >>= 1;
+	starts[offset >> 5] |= 1u << (offset & 31);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_insn_index_build(AHPInsnIndex* index, const AHPInfo* info, int sectionIndex, AHPCpu cpu)
+{
+	const AHPSection* section = &info->sections[sectionIndex];
+	uint32_t* relocs = 0;
+	uint32_t* syncs = 0;
+	int relocCount = 0, syncCount = 0;
+	int ri = 0, si = 0;
+
+	memset(index, 0, sizeof(AHPInsnIndex));
+
+	if (section->type != AHPSectionType_Code || section->dataSize <= 0)
+		return 0;
+
+	const uint8_t* code = (const uint8_t*)info->fileData + section->dataStart;
+	const uint32_t size = (uint32_t)section->dataSize;
+	const uint32_t wordCount = (size + 1) / 2;
+
+	index->size = size;
+	index->starts = (uint32_t*)calloc((wordCount + 31) / 32, sizeof(uint32_t));
+
+	// Relocated longwords are operands or pointer data, never opcodes, and symbols always start an instruction.
+	// Both are used to get the linear sweep back in sync after data in the code section.
+
+	relocs = ahp_get_reloc_offsets(info, section, &relocCount);
+
+	if (section->symbolCount > 0)
+	{
+		syncs = (uint32_t*)malloc(section->symbolCount * sizeof(uint32_t));
+
+		for (int i = 0; i < section->symbolCount; ++i)
+		{
+			const uint32_t address = section->symbols[i].address;
+
+			if (address < size && !(address & 1))
+				syncs[syncCount++] = address;
+		}
+
+		// symbol tables are almost always sorted already
+
+		for (int i = 1; i < syncCount; ++i)
+		{
+			uint32_t t = syncs[i];
+			int j = i - 1;
+
+			for (; j >= 0 && syncs[j] > t; --j)
+				syncs[j + 1] = syncs[j];
+
+			syncs[j + 1] = t;
+		}
+	}
+
+	uint32_t pos = 0;
+
+	while (pos < size)
+	{
+		while (ri < relocCount && relocs[ri] + 4 <= pos)
+			ri++;
+
+		while (si < syncCount && syncs[si] <= pos)
+			si++;
+
+		markStart(index->starts, pos);
+
+		if (ri < relocCount && relocs[ri] <= pos)
+		{
+			pos = (relocs[ri] + 4 + 1) & ~1u;
+			continue;
+		}
+
+		uint32_t len = (uint32_t)ahp_insn_length(code, size, pos, cpu);
+
+		if (len == 0)
+		{
+			pos += 2;
+			continue;
+		}
+
+		const uint32_t end = pos + len;
+
+		// a relocation that straddles the end of the instruction means we decoded garbage
+
+		for (int i = ri; i < relocCount && relocs[i] < end; ++i)
+		{
+			if (relocs[i] + 4 > end || relocs[i] < pos + 2)
+			{
+				len = 2;
+				break;
+			}
+		}
+
+		// never step over a symbol
+
+		if (si < syncCount && syncs[si] < pos + len)
+			len = syncs[si] - pos;
+
+		pos += len;
+	}
+
+	free(relocs);
+	free(syncs);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct BuildJob
+{
+	AHPInsnIndex* indices;
+	const AHPInfo* info;
+	AHPCpu cpu;
+	int nextSection;
+
+#if defined(AHP_INSN_THREADS)
+	pthread_mutex_t lock;
+#endif
+
+} BuildJob;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int takeSection(BuildJob* job)
+{
+	int section = -1;
+
+#if defined(AHP_INSN_THREADS)
+	pthread_mutex_lock(&job->lock);
+#endif
+
+	if (job->nextSection < job->info->sectionCount)
+		section = job->nextSection++;
+
+#if defined(AHP_INSN_THREADS)
+	pthread_mutex_unlock(&job->lock);
+#endif
+
+	return section;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* buildThread(void* arg)
+{
+	BuildJob* job = (BuildJob*)arg;
+	int section;
+
+	while ((section = takeSection(job)) >= 0)
+		ahp_insn_index_build(&job->indices[section], job->info, section, job->cpu);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_insn_index_build_all(AHPInsnIndex* indices, const AHPInfo* info, AHPCpu cpu, int threadCount)
+{
+	BuildJob job;
+
+	job.indices = indices;
+	job.info = info;
+	job.cpu = cpu;
+	job.nextSection = 0;
+
+#if defined(AHP_INSN_THREADS)
+	pthread_t threads[MAX_BUILD_THREADS];
+	int started = 0;
+
+	if (threadCount > info->sectionCount)
+		threadCount = info->sectionCount;
+
+	if (threadCount > MAX_BUILD_THREADS)
+		threadCount = MAX_BUILD_THREADS;
+
+	pthread_mutex_init(&job.lock, 0);
+
+	// if a thread can't be started the ones that did (and this one) just take more sections each
+
+	while (started < threadCount - 1 && pthread_create(&threads[started], 0, buildThread, &job) == 0)
+		started++;
+
+	buildThread(&job);
+
+	for (int i = 0; i < started; ++i)
+		pthread_join(threads[i], 0);
+
+	pthread_mutex_destroy(&job.lock);
+#else
+	(void)threadCount;
+	buildThread(&job);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_insn_index_free(AHPInsnIndex* index)
+{
+	free(index->starts);
+	memset(index, 0, sizeof(AHPInsnIndex));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// As no item in the index is longer than AHP_INSN_MAX_LENGTH the previous start is always in the same or the
+// previous bitmap word, so both lookups are a couple of bit scans.
+
+uint32_t ahp_insn_find_start(const AHPInsnIndex* index, uint32_t offset)
+{
+	if (index->size == 0)
+		return 0;
+
+	if (offset >= index->size)
+		offset = index->size - 1;
+
+	uint32_t word = offset >> 1;
+	uint32_t slot = word >> 5;
+	uint32_t bits = index->starts[slot] & (0xffffffffu >> (31 - (word & 31)));
+
+	while (!bits && slot > 0)
+		bits = index->starts[--slot];
+
+	if (!bits)
+		return 0;
+
+	return ((slot << 5) + highestBit(bits)) << 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t ahp_insn_next(const AHPInsnIndex* index, uint32_t offset)
+{
+	const uint32_t slotCount = (((index->size + 1) / 2) + 31) / 32;
+
+	if (offset >= index->size)
+		return index->size;
+
+	uint32_t word = (offset >> 1) + 1;
+	uint32_t slot = word >> 5;
+
+	if (slot >= slotCount)
+		return index->size;
+
+	uint32_t bits = (word & 31) ? index->starts[slot] & (0xffffffffu << (word & 31)) : index->starts[slot];
+
+	while (!bits && ++slot < slotCount)
+		bits = index->starts[slot];
+
+	if (!bits)
+		return index->size;
+
+	return ((slot << 5) + lowestBit(bits)) << 1;
+}
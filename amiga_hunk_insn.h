@@ -0,0 +1,65 @@
+#ifndef AMIGA_HUNK_INSN_
+#define AMIGA_HUNK_INSN_
+
+#include "amiga_hunk_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Optional 68k instruction boundary index for CODE sections. Each section is decoded once and the result is stored
+// as a bitmap with one bit per 16-bit word that is set where an instruction starts. Words that can't be decoded
+// (data in code, unknown opcodes) get their own bit as well so every offset maps to an item of at most
+// AHP_INSN_MAX_LENGTH bytes, which is what keeps the lookups O(1).
+//
+// Building only reads the AHPInfo so indices for different sections can be built from separate threads.
+
+#define AHP_INSN_MAX_LENGTH 22
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef enum AHPCpu
+{
+	AHPCpu_68000,
+	AHPCpu_68020, // 68020 addressing modes and instructions plus 68881/68882 FPU
+} AHPCpu;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPInsnIndex
+{
+	uint32_t size;		// size of the section data in bytes
+	uint32_t* starts;	// one bit per 16-bit word
+
+} AHPInsnIndex;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Length in bytes of the instruction at offset, 0 if it isn't a valid instruction or doesn't fit in size
+int ahp_insn_length(const uint8_t* code, uint32_t size, uint32_t offset, AHPCpu cpu);
+
+// Returns 0 if the section isn't a CODE section (index is left empty)
+int ahp_insn_index_build(AHPInsnIndex* index, const AHPInfo* info, int sectionIndex, AHPCpu cpu);
+
+// Builds the indices of all sections (indices has sectionCount entries, the ones that aren't CODE are left empty) on
+// up to threadCount threads, the calling one included, each taking the next section nobody has started on yet.
+// Without pthreads (Windows) the sections are built one after another.
+void ahp_insn_index_build_all(AHPInsnIndex* indices, const AHPInfo* info, AHPCpu cpu, int threadCount);
+void ahp_insn_index_free(AHPInsnIndex* index);
+
+// Start of the instruction that contains offset
+uint32_t ahp_insn_find_start(const AHPInsnIndex* index, uint32_t offset);
+
+// Start of the first instruction after the one that contains offset, index->size if there is none
+uint32_t ahp_insn_next(const AHPInsnIndex* index, uint32_t offset);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int ahp_insn_is_start(const AHPInsnIndex* index, uint32_t offset)
+{
+	if (offset >= index->size || (offset & 1))
+		return 0;
+
+	offset >>= 1;
+
+	return (index->starts[offset >> 5] >> (offset & 31)) & 1;
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "amiga_hunk_parser.h"
 #include "doshunks.h"
+#include "endian.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -7,57 +8,6 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#if defined (__AROS__)
-    #include <aros/cpu.h>
-    #if AROS_BIG_ENDIAN
-        #define AHP_BIG_ENDIAN
-        #define AHP_BYTE_ORDER 4321
-    #else
-        #define AHP_LITTLE_ENDIAN
-        #define AHP_BYTE_ORDER 1234
-    #endif
-#else
-#if defined (__GLIBC__)
-#include <endian.h>
-#if (__BYTE_ORDER == __LITTLE_ENDIAN)
-	#define AHP_LITTLE_ENDIAN
-#elif (__BYTE_ORDER == __BIG_ENDIAN)
-	#define AHP_BIG_ENDIAN
-#elif (__BYTE_ORDER == __PDP_ENDIAN)
-	#define AHP_BIG_ENDIAN
-#else
-	#error "Unable to detect endian for your target."
-#endif
-	#define AHP_BYTE_ORDER __BYTE_ORDER
-#elif defined(_BIG_ENDIAN)
-	#define AHP_BIG_ENDIAN
-	#define AHP_BYTE_ORDER 4321
-#elif defined(_LITTLE_ENDIAN)
-	#define AHP_LITTLE_ENDIAN
-	#define AHP_BYTE_ORDER 1234
-#elif defined(__sparc) || defined(__sparc__) \
-   || defined(_POWER) || defined(__powerpc__) \
-   || defined(__ppc__) || defined(__hpux) \
-   || defined(_MIPSEB) || defined(_POWER) \
-   || defined(__s390__)
-	#define AHP_BIG_ENDIAN
-	#define AHP_BYTE_ORDER 4321
-#elif defined(__i386__) || defined(__alpha__) \
-   || defined(__ia64) || defined(__ia64__) \
-   || defined(_M_IX86) || defined(_M_IA64) \
-   || defined(_M_ALPHA) || defined(__amd64) \
-   || defined(__amd64__) || defined(_M_AMD64) \
-   || defined(__x86_64) || defined(__x86_64__) \
-   || defined(_M_X64) || defined(__arm64__)
-	#define AHP_LITTLE_ENDIAN
-	#define AHP_BYTE_ORDER 1234
-#else
-	#error "Unable to detect endian for your target."
-#endif
-#endif
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 const char* hunktype[HUNK_ABSRELOC16 - HUNK_UNIT + 1] = 
 {
     "UNIT", "NAME", "CODE", "DATA", "BSS ", "RELOC32", "RELOC16", "RELOC8",
@@ -113,58 +63,6 @@ typedef struct AHPSection
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static inline uint16_t swap_uint16(uint16_t val)
-{
-    return (val << 8) | (val >> 8);
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-static inline uint32_t swap_uint32(uint32_t val)
-{
-    return ((val & 0x000000ff) << 24) |
-           ((val & 0x0000ff00) << 8) |
-           ((val & 0x00ff0000) >> 8) |
-           ((val & 0xff000000) >> 24);
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-uint32_t get_u32 (const void* t, int index)
-{
-    uint32_t* mem = (uint32_t*)(((uint8_t*)t) + index);
-#if defined(AHP_LITTLE_ENDIAN)
-    return swap_uint32(*mem);
-#endif
-    return *mem;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-uint32_t get_u32_inc (const void* t, int* index)
-{
-    uint32_t* mem = (uint32_t*)(((uint8_t*)t) + *index);
-    *index += 4;
-#if defined(AHP_LITTLE_ENDIAN)
-    return swap_uint32(*mem);
-#endif
-    return *mem;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-uint16_t get_u16_inc (const void* t, int* index)
-{
-    uint16_t* mem = (uint16_t*)(((uint8_t*)t) + *index);
-    *index += 2;
-#if defined(AHP_LITTLE_ENDIAN)
-    return swap_uint16(*mem);
-#endif
-    return *mem;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 void* loadToMemory(const char* filename, size_t* size)
 {
     FILE* f = fopen(filename, "rb");
@@ -219,57 +117,145 @@ void* alloc_zero(size_t size)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void parseSymbols(AHPSection* section, const void* data, int* currIndex)
+static int compareSymbols(const void* a, const void* b)
 {
-	int oldIndex, index, i = 0;
-	int symCount = 0;
+	const uint32_t va = ((const AHPSymbolInfo*)a)->address;
+	const uint32_t vb = ((const AHPSymbolInfo*)b)->address;
+	return (va > vb) - (va < vb);
+}
 
-	index = oldIndex = *currIndex;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void parseSymbols(AHPSection* section, AHPReader* reader)
+{
+	const uint32_t start = reader->index;
+	int i = 0, symCount = 0, sorted = 1;
 
 	// count symbols
 
-	int symlen = get_u32_inc(data, &index) * 4;
+	uint32_t symlen = get_u32_inc(reader) * 4;
 
 	while (symlen > 0)
 	{
 		symCount++;
-		index += symlen + 4;
-		symlen = get_u32_inc(data, &index) * 4;
+		reader_skip(reader, symlen + 4);
+		symlen = get_u32_inc(reader) * 4;
 	}
 
+	if (reader->overrun)
+		return;
+
 	section->symbolCount = symCount;
 	section->symbols = xalloc(AHPSymbolInfo, symCount);
 
-	index = oldIndex;
+	reader->index = start;
 
-	symlen = get_u32_inc(data, &index) * 4;
+	symlen = get_u32_inc(reader) * 4;
 
 	while (symlen > 0)
 	{
 		AHPSymbolInfo* info = &section->symbols[i++];
-		info->name = ((const char*)data) + index;
-		index += symlen;
-		info->address = get_u32_inc(data, &index) * 4;
-		symlen = get_u32_inc(data, &index) * 4;
+		info->name = ((const char*)reader->data) + reader->index;
+		reader->index += symlen;
+		info->address = get_u32_inc(reader);
+		symlen = get_u32_inc(reader) * 4;
+
+		if (i > 1 && info->address < section->symbols[i - 2].address)
+			sorted = 0;
 	}
 
-	*currIndex = index;
+	// lookups do binary searches on the symbols so make sure they are ordered by address
+
+	if (!sorted)
+		qsort(section->symbols, symCount, sizeof(AHPSymbolInfo), compareSymbols);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void parseDebug(AHPSection* section, const void* data, int* currIndex)
+typedef struct LineEntry
+{
+	uint32_t address;
+	uint32_t order;
+	int line;
+
+} LineEntry;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareLineEntries(const void* a, const void* b)
+{
+	const LineEntry* ea = (const LineEntry*)a;
+	const LineEntry* eb = (const LineEntry*)b;
+
+	if (ea->address != eb->address)
+		return (ea->address > eb->address) - (ea->address < eb->address);
+
+	return (ea->order > eb->order) - (ea->order < eb->order);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Lookups binary search the addresses, entries with the same address keep the order they had in the file
+
+static void sortLines(AHPLineInfo* lineInfo)
+{
+	const int count = lineInfo->count;
+	LineEntry* entries = xalloc(LineEntry, count);
+
+	for (int i = 0; i < count; ++i)
+	{
+		entries[i].address = lineInfo->addresses[i];
+		entries[i].order = (uint32_t)i;
+		entries[i].line = lineInfo->lines[i];
+	}
+
+	qsort(entries, count, sizeof(LineEntry), compareLineEntries);
+
+	for (int i = 0; i < count; ++i)
+	{
+		lineInfo->addresses[i] = entries[i].address;
+		lineInfo->lines[i] = entries[i].line;
+	}
+
+	free(entries);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void parseDebug(AHPSection* section, AHPReader* reader)
 {
-	int index = *currIndex;
 	AHPLineInfo* lineInfo = 0;
 
-	const uint32_t hunkLength = get_u32_inc(data, &index) * 4;
-	const uint32_t baseOffset = get_u32_inc(data, &index) * 4;
-	const uint32_t debugId = get_u32_inc(data, &index);
+	const uint32_t hunkLength = get_u32_inc(reader) * 4;
+
+	if (!reader_has(reader, hunkLength))
+	{
+		reader_fail(reader);
+		return;
+	}
+
+	const uint32_t hunkEnd = reader->index + hunkLength;
+
+	// the contents are up to whoever wrote them, anything too short to be a LINE block is kept as is
+
+	if (hunkLength < 3 * 4 || get_u32(reader, reader->index + 4) != HUNK_DEBUG_LINE)
+	{
+		const int blockCount = section->debugBlockCount++;
+		section->debugBlocks = realloc(section->debugBlocks, (blockCount + 1) * sizeof(AHPDebugBlock));
+		section->debugBlocks[blockCount].start = hunkEnd - hunkLength;
+		section->debugBlocks[blockCount].size = hunkLength;
+
+		reader_seek(reader, hunkEnd);
+		return;
+	}
+
+	const uint32_t baseOffset = get_u32_inc(reader);
+	reader_skip(reader, 4); // 'LINE'
+
+	const uint32_t stringLength = get_u32_inc(reader) * 4;
 
-	if (debugId != HUNK_DEBUG_LINE)
+	if (stringLength > hunkLength - (3 * 4))
 	{
-		*currIndex += hunkLength;
+		reader_fail(reader);
 		return;
 	}
 
@@ -288,37 +274,42 @@ static void parseDebug(AHPSection* section, const void* data, int* currIndex)
 		memset(lineInfo, 0, sizeof(AHPLineInfo));
 	}
 
-	const uint32_t stringLength = get_u32_inc(data, &index) * 4;
-
 	lineInfo->baseOffset = baseOffset;
-	lineInfo->filename = ((const char*)data) + index;
+	lineInfo->filename = ((const char*)reader->data) + reader->index;
 
-	index += stringLength;
+	reader->index += stringLength;
 
 	// M = ((N - 3) - number_of_string_longwords) / 2
 
 	const int lineCount = ((hunkLength - (3 * 4)) - stringLength) / 8;
+	const uint8_t* entries = reader->data + reader->index;
 
 	lineInfo->addresses = xalloc(uint32_t, lineCount); 
 	lineInfo->lines = xalloc(int, lineCount); 
 
+	int sorted = 1;
+
 	for (int i = 0; i < lineCount; ++i)
 	{
-		lineInfo->lines[i] = (int)get_u32_inc(data, &index); 
-		lineInfo->addresses[i] = (uint32_t)get_u32_inc(data, &index); 
+		lineInfo->lines[i] = (int)ahp_load_be32(entries + i * 8);
+		lineInfo->addresses[i] = ahp_load_be32(entries + i * 8 + 4);
+
+		if (i > 0 && lineInfo->addresses[i] < lineInfo->addresses[i - 1])
+			sorted = 0;
 	}
 
 	lineInfo->count = lineCount;
-	
-	*currIndex += hunkLength + 4;
+
+	if (!sorted)
+		sortLines(lineInfo);
+
+	reader_seek(reader, hunkEnd);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void parseCodeDataBss(AHPSection* section, int type, const void* data, int* currIndex)
+static void parseCodeDataBss(AHPSection* section, int type, AHPReader* reader)
 {
-	int index = *currIndex;
-
 	switch (type)
 	{
 		case HUNK_CODE: section->type = AHPSectionType_Code; break;
@@ -326,113 +317,170 @@ static void parseCodeDataBss(AHPSection* section, int type, const void* data, in
 		case HUNK_BSS: section->type = AHPSectionType_Bss; break;
 	}
 
-	section->dataSize = get_u32_inc(data, &index) * 4;
+	section->dataSize = get_u32_inc(reader) * 4;
 
 	if (type != HUNK_BSS)
 	{
-		section->dataStart = index;
-		index += section->dataSize;
+		section->dataStart = reader->index;
+		reader_skip(reader, section->dataSize);
+	}
+}
 
-		if (section->dataSize > 0)
-		{
-			int sum = 0;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// All relocation hunks share two encodings: runs of (count, target hunk, offsets...) with either 32-bit or 16-bit
+// fields. The table maps each hunk type to its encoding and to what the relocation means so they can all be decoded
+// by the same two loops.
 
-			for (int pos = section->dataStart; pos < section->dataStart + section->dataSize; pos += 4)
-				sum += get_u32(data, pos);
+typedef struct RelocFormat
+{
+	uint32_t hunkType;
+	uint8_t kind;
+	uint8_t width;
+	uint8_t shortEntries;
 
-			(void)sum;
-		}
+} RelocFormat;
+
+static const RelocFormat s_relocFormats[] =
+{
+	{ HUNK_RELOC32, AHPRelocKind_Absolute, 4, 0 },
+	{ HUNK_RELOC32SHORT, AHPRelocKind_Absolute, 4, 1 },
+	{ HUNK_DREL32, AHPRelocKind_Absolute, 4, 1 }, // V37 LoadSeg uses 1015 for RELOC32SHORT, see doshunks.h
+	{ HUNK_RELOC16, AHPRelocKind_PcRelative, 2, 0 },
+	{ HUNK_RELOC8, AHPRelocKind_PcRelative, 1, 0 },
+	{ HUNK_RELRELOC32, AHPRelocKind_PcRelative, 4, 1 }, // V39 LoadSeg reads it in the short format
+	{ HUNK_DREL16, AHPRelocKind_DataRelative, 2, 0 },
+	{ HUNK_DREL8, AHPRelocKind_DataRelative, 1, 0 },
+	{ HUNK_ABSRELOC16, AHPRelocKind_Absolute, 2, 0 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const RelocFormat* findRelocFormat(int type)
+{
+	for (size_t i = 0; i < sizeof(s_relocFormats) / sizeof(s_relocFormats[0]); ++i)
+	{
+		if (s_relocFormats[i].hunkType == (uint32_t)type)
+			return &s_relocFormats[i];
 	}
 
-	*currIndex = index;
+	return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decodes one run of relocation offsets. The bounds check for the whole run is done up front so the inner loop is
+// only loads, stores and compares.
 
-static void parseReloc32(AHPSection* section, const void* data, int* currIndex)
+static int decodeRelocs32(AHPReloc* out, const uint8_t* offsets, uint32_t count, AHPReloc reloc, uint32_t limit)
 {
-	int index = *currIndex;
+	uint32_t bad = 0;
 
-	section->relocStart = index;
-	int n, tot = 0;
-
-	while ((n = get_u32_inc(data, &index)) != 0)
+	for (uint32_t i = 0; i < count; ++i)
 	{
-		uint32_t t = get_u32_inc(data, &index);
-		(void)t;
+		reloc.offset = ahp_load_be32(offsets + i * 4);
+		bad |= reloc.offset > limit;
+		out[i] = reloc;
+	}
 
-		tot += n;
+	return !bad;
+}
 
-		while (n--)
-		{
-			if ((get_u32_inc(data, &index)) > section->memSize - 4)
-			{
-				printf("\nError in reloc table!\n");
-				exit(1);
-			}
-		}
-	}
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    section->relocCount = tot;
+static int decodeRelocs16(AHPReloc* out, const uint8_t* offsets, uint32_t count, AHPReloc reloc, uint32_t limit)
+{
+	uint32_t bad = 0;
 
-	*currIndex = index;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		reloc.offset = ahp_load_be16(offsets + i * 2);
+		bad |= reloc.offset > limit;
+		out[i] = reloc;
+	}
+
+	return !bad;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void parseDreloc32(AHPSection* section, const void* data, int* currIndex)
+static int parseRelocs(AHPSection* section, AHPReader* reader, const RelocFormat* format, uint32_t sectionCount)
 {
-	int index = *currIndex;
+	const uint32_t entrySize = format->shortEntries ? 2 : 4;
+	const uint32_t memSize = (uint32_t)section->memSize;
+	const uint32_t limit = memSize >= format->width ? memSize - format->width : 0;
+	AHPReloc reloc;
+	uint32_t n;
 
-	section->relocStart = index;
+	if (section->relocCount == 0)
+		section->relocStart = reader->index;
 
-	int n, tot = 0;
+	reloc.kind = format->kind;
+	reloc.width = format->width;
 
-	while ((n = get_u16_inc(data, &index)) != 0)
+	while ((n = format->shortEntries ? get_u16_inc(reader) : get_u32_inc(reader)) != 0)
 	{
-		uint16_t t = get_u16_inc(data, &index);
-		(void)t;
+		const uint32_t target = format->shortEntries ? get_u16_inc(reader) : get_u32_inc(reader);
 
-		tot += n;
+		if (reader->overrun || n > (reader->size - reader->index) / entrySize)
+		{
+			printf("\nUnexpected end of file!\n");
+			return 0;
+		}
+
+		// nothing fits in a section smaller than the relocated value
 
-		while (n--)
+		if (target >= sectionCount || memSize < format->width)
 		{
-			uint16_t t = get_u16_inc(data, &index);
+			printf("\nError in reloc table!\n");
+			return 0;
+		}
 
-			if (t > section->memSize - 4)
-			{
-				printf("\nError in reloc table!\n");
-				exit(1);
-			}
+		section->relocs = realloc(section->relocs, (section->relocCount + n) * sizeof(AHPReloc));
+
+		AHPReloc* out = &section->relocs[section->relocCount];
+		const uint8_t* offsets = reader->data + reader->index;
+		int ok;
+
+		reloc.target = (uint16_t)target;
+
+		if (format->shortEntries)
+			ok = decodeRelocs16(out, offsets, n, reloc, limit);
+		else
+			ok = decodeRelocs32(out, offsets, n, reloc, limit);
+
+		if (!ok)
+		{
+			printf("\nError in reloc table!\n");
+			return 0;
 		}
-	}
 
-	if (index & 2)
-		index += 2;
+		reader->index += n * entrySize;
+		section->relocCount += n;
+	}
 
-	section->relocCount = tot;
+	if (format->shortEntries && (reader->index & 2))
+		reader_skip(reader, 2);
 
-	*currIndex = index;
+	return 1;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static int parseSection(AHPSection* section, const void* data, int hunkId, int size, int* currIndex)
+static int parseSection(AHPSection* section, AHPReader* reader, int hunkId, uint32_t sectionCount)
 {
+	const RelocFormat* relocFormat;
 	int type;
-	int index = *currIndex;
 
 	for (;;)
 	{
-		if (index >= size)
+		if (!reader_has(reader, 4))
 		{
 			printf("\nUnexpected end of file!\n");
 			return 0;
 		}
 
-		type = get_u32_inc(data, &index) & 0x0fffffff;
+		type = get_u32_inc(reader) & 0x0fffffff;
 
-		if (index >= size && type != HUNK_END)
+		if (!reader_has(reader, 1) && type != HUNK_END)
 		{
 			printf("\nUnexpected end of file!\n");
 			return 0;
@@ -440,39 +488,46 @@ static int parseSection(AHPSection* section, const void* data, int hunkId, int s
 
 		switch (type)
 		{
-			case HUNK_DEBUG: parseDebug(section, data, &index); break;
-			case HUNK_SYMBOL: parseSymbols(section, data, &index); break;
+			case HUNK_DEBUG: parseDebug(section, reader); break;
+			case HUNK_SYMBOL: parseSymbols(section, reader); break;
 
 			case HUNK_CODE:
 			case HUNK_DATA:
-			case HUNK_BSS: parseCodeDataBss(section, type, data, &index); break;
-			case HUNK_RELOC32: parseReloc32(section, data, &index); break;
+			case HUNK_BSS: parseCodeDataBss(section, type, reader); break;
 
+			case HUNK_RELOC32:
+			case HUNK_RELOC16:
+			case HUNK_RELOC8:
 			case HUNK_DREL32:
-			case HUNK_RELOC32SHORT: parseDreloc32(section, data, &index); break;
+			case HUNK_DREL16:
+			case HUNK_DREL8:
+			case HUNK_RELOC32SHORT:
+			case HUNK_RELRELOC32:
+			case HUNK_ABSRELOC16:
+			{
+				relocFormat = findRelocFormat(type);
+
+				if (!parseRelocs(section, reader, relocFormat, sectionCount))
+					return 0;
+
+				break;
+			}
 
 			case HUNK_UNIT:
 			case HUNK_NAME:
-			case HUNK_RELOC16:
-			case HUNK_RELOC8:
 			case HUNK_EXT:
 			case HUNK_HEADER:
 			case HUNK_OVERLAY:
 			case HUNK_BREAK:
-			case HUNK_DREL16:
-			case HUNK_DREL8:
 			case HUNK_LIB:
 			case HUNK_INDEX:
-			case HUNK_RELRELOC32:
-			case HUNK_ABSRELOC16:
 			{
-				printf("%s (unsupported) at %d\n", hunktype[type - HUNK_UNIT], index);
+				printf("%s (unsupported) at %u\n", hunktype[type - HUNK_UNIT], reader->index);
 				return 0;
 			}
 
 			case HUNK_END: 
 			{
-				*currIndex = index;
 				return 1; 
 			}
 
@@ -482,6 +537,12 @@ static int parseSection(AHPSection* section, const void* data, int hunkId, int s
 				return 0;
 			}
 		}
+
+		if (reader->overrun)
+		{
+			printf("\nUnexpected end of file!\n");
+			return 0;
+		}
 	}
 
 	return 1;
@@ -489,14 +550,104 @@ static int parseSection(AHPSection* section, const void* data, int hunkId, int s
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-AHPInfo* ahp_parse_file(const char* filename)
+static void clearOwnedData(AHPSection* section)
+{
+	section->symbols = 0;
+	section->symbolCount = 0;
+	section->debugLines = 0;
+	section->debugLineCount = 0;
+	section->debugBlocks = 0;
+	section->debugBlockCount = 0;
+	section->relocs = 0;
+	section->relocCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checks if the hunks at the current position are the same as the ones of the section in the previous parse and skips
+// them if so. Nothing is taken from prev yet so it's still intact if a later section fails to parse.
+
+static int reuseSection(AHPSection* section, const AHPSection* prevSection, const AHPInfo* prev, AHPReader* reader,
+						uint32_t sectionCount)
+{
+	const uint8_t* prevData = (const uint8_t*)prev->fileData;
+
+	if (prevSection->hunkSize == 0 || !reader_has(reader, prevSection->hunkSize))
+		return 0;
+
+	if (section->memSize != prevSection->memSize || section->target != prevSection->target)
+		return 0;
+
+	if (memcmp(reader->data + reader->index, prevData + prevSection->hunkStart, prevSection->hunkSize) != 0)
+		return 0;
+
+	// the relocations were only checked against the section count of the previous file
+
+	for (int i = 0; i < prevSection->relocCount; ++i)
+	{
+		if (prevSection->relocs[i].target >= sectionCount)
+			return 0;
+	}
+
+	section->hunkStart = reader->index;
+	section->hunkSize = prevSection->hunkSize;
+
+	reader->index += prevSection->hunkSize;
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// File offset inside a reused section in its new position, 0 is an offset that was never set (no data for BSS, no
+// relocations)
+
+static uint32_t rebaseOffset(uint32_t offset, uint32_t prevHunkStart, uint32_t hunkStart)
+{
+	return offset ? hunkStart + (offset - prevHunkStart) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Moves the parsed data of a reused section over from prev, pointers and offsets into the file are rebased. The
+// section can be earlier in the new file than in prev so everything is made relative to the start of its hunks first.
+
+static void adoptSection(AHPSection* section, AHPSection* prevSection, const AHPInfo* prev, const AHPInfo* info)
+{
+	const char* prevStart = (const char*)prev->fileData + prevSection->hunkStart;
+	const char* start = (const char*)info->fileData + section->hunkStart;
+	const uint32_t prevHunkStart = prevSection->hunkStart;
+	const uint32_t hunkStart = section->hunkStart;
+
+	*section = *prevSection;
+
+	section->hunkStart = hunkStart;
+	section->dataStart = rebaseOffset(section->dataStart, prevHunkStart, hunkStart);
+	section->relocStart = rebaseOffset(section->relocStart, prevHunkStart, hunkStart);
+
+	for (int i = 0; i < section->symbolCount; ++i)
+		section->symbols[i].name = start + (section->symbols[i].name - prevStart);
+
+	for (int i = 0; i < section->debugLineCount; ++i)
+	{
+		AHPLineInfo* lineInfo = &section->debugLines[i];
+		lineInfo->filename = start + (lineInfo->filename - prevStart);
+	}
+
+	for (int i = 0; i < section->debugBlockCount; ++i)
+		section->debugBlocks[i].start = rebaseOffset(section->debugBlocks[i].start, prevHunkStart, hunkStart);
+
+	clearOwnedData(prevSection);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static AHPInfo* parseFile(const char* filename, AHPInfo* prev)
 {
     size_t size = 0;
     void* data = loadToMemory(filename, &size);
-    uint32_t header = 0;
-    int h, index = 0;
-    int sectionCount = 0;
+    uint32_t header = 0, nameLength;
+    uint32_t h, sectionCount = 0;
     AHPSection* sections = 0;
+    AHPReader reader;
+    uint8_t* reused = 0;
 
     if (!data)
     {
@@ -505,18 +656,28 @@ AHPInfo* ahp_parse_file(const char* filename)
     }
 
     AHPInfo* info = xalloc_zero(AHPInfo, 1);
+    info->fileData = data;
+
+    if (size > UINT32_MAX)
+    {
+        printf("File %s is too large\n", filename);
+        ahp_free(info);
+        return 0;
+    }
+
+    reader_init(&reader, data, (uint32_t)size);
 
-    if (get_u32_inc(data, &index) != HUNK_HEADER)
+    if ((header = get_u32_inc(&reader)) != HUNK_HEADER)
     {
         printf("HunkHeader is incorrect (should be 0x%08x but is 0x%08x)\n", HUNK_HEADER, header);
         ahp_free(info);
         return 0;
     }
 
-    while (get_u32_inc(data, &index))
+    while ((nameLength = get_u32_inc(&reader)))
     {
-        index += get_u32(data, index) * 4;
-        if (index >= size)
+        reader_skip(&reader, nameLength * 4);
+        if (reader.overrun)
         {
             printf("Bad hunk header!\n");
         	ahp_free(info);
@@ -524,19 +685,28 @@ AHPInfo* ahp_parse_file(const char* filename)
         }
     }
 
-    sectionCount = get_u32_inc(data, &index);
+    sectionCount = get_u32_inc(&reader);
+
+    // relocation targets are stored in 16 bits
 
-    if (sectionCount == 0)
+    if (sectionCount > UINT16_MAX)
     {
-        printf("No sections!\n");
+        printf("Too many sections (%u)\n", sectionCount);
+        ahp_free(info);
+        return 0;
+    }
+
+    if (sectionCount == 0 || sectionCount > (reader.size - reader.index) / 4)
+    {
+        printf(sectionCount == 0 ? "No sections!\n" : "Bad hunk header!\n");
 		ahp_free(info);
         return 0;
     }
 
 	info->sections = sections = xalloc_zero(AHPSection, sectionCount); 
-	info->sectionCount = sectionCount;
+	info->sectionCount = (int)sectionCount;
 
-    if (get_u32_inc(data, &index) != 0 || get_u32_inc(data, &index) != sectionCount - 1)
+    if (get_u32_inc(&reader) != 0 || get_u32_inc(&reader) != sectionCount - 1)
     {
         printf("Unsupported hunk load limits!\n");
         ahp_free(info);
@@ -549,8 +719,9 @@ AHPInfo* ahp_parse_file(const char* filename)
     {
     	AHPSectionTarget target = AHPSectionTarget_Any;
 
-        sections[h].memSize = (get_u32(data, index) & 0x0fffffff) * 4;
-        uint32_t flags = get_u32(data, index) & 0xf0000000;
+        uint32_t hunkSize = get_u32_inc(&reader);
+        sections[h].memSize = (hunkSize & 0x0fffffff) * 4;
+        uint32_t flags = hunkSize & 0xf0000000;
 
         switch (flags)
 		{
@@ -560,22 +731,49 @@ AHPInfo* ahp_parse_file(const char* filename)
 		}
 
 		sections[h].target = target;
-
-        index += 4;
     }
 
+    if (prev)
+    	reused = xalloc_zero(uint8_t, sectionCount);
+
     for (h = 0; h < sectionCount; ++h)
     {
-    	if (!parseSection(&sections[h], data, h, size, &index)) 
+    	AHPSection* section = &sections[h];
+
+    	if (prev && h < (uint32_t)prev->sectionCount &&
+    		reuseSection(section, &prev->sections[h], prev, &reader, sectionCount))
+    	{
+    		reused[h] = 1;
+    		continue;
+    	}
+
+    	section->hunkStart = reader.index;
+
+    	if (!parseSection(section, &reader, h, sectionCount)) 
 		{
+			free(reused);
 			ahp_free(info);
     		return 0; 
 		}
+
+    	section->hunkSize = reader.index - section->hunkStart;
     }
 
-    if (index < size)
+    if (reader.index < reader.size)
     {
-        printf("Warning: %d bytes of extra data at the end of the file!\n", (int)(size - index) * 4);
+        printf("Warning: %u bytes of extra data at the end of the file!\n", reader.size - reader.index);
+    }
+
+    if (prev)
+    {
+    	for (h = 0; h < sectionCount; ++h)
+    	{
+    		if (reused[h])
+    			adoptSection(&sections[h], &prev->sections[h], prev, info);
+    	}
+
+    	free(reused);
+    	ahp_free(prev);
     }
 
     return info;
@@ -583,6 +781,149 @@ AHPInfo* ahp_parse_file(const char* filename)
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+AHPInfo* ahp_parse_file(const char* filename)
+{
+	return parseFile(filename, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPInfo* ahp_reparse(AHPInfo* prev, const char* filename)
+{
+	return parseFile(filename, prev);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t ahp_section_hash(const AHPInfo* info, const AHPSection* section)
+{
+	const uint8_t* data = (const uint8_t*)info->fileData + section->hunkStart;
+	const uint32_t size = section->hunkSize;
+	uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+	uint32_t i = 0;
+
+	// loads are big endian so the hash is the same on all hosts
+
+	for (; i + 8 <= size; i += 8)
+	{
+		const uint64_t v = ((uint64_t)ahp_load_be32(data + i) << 32) | ahp_load_be32(data + i + 4);
+		h = (h ^ v) * 0xff51afd7ed558ccdull;
+		h ^= h >> 32;
+	}
+
+	for (; i < size; ++i)
+		h = (h ^ data[i]) * 0x100000001b3ull;
+
+	return h;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareU32(const void* a, const void* b)
+{
+	const uint32_t va = *(const uint32_t*)a;
+	const uint32_t vb = *(const uint32_t*)b;
+	return (va > vb) - (va < vb);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t* ahp_get_reloc_offsets(const AHPInfo* info, const AHPSection* section, int* count)
+{
+	uint32_t* offsets;
+	int tot = 0;
+
+	(void)info;
+
+	*count = 0;
+
+	if (section->relocCount == 0)
+		return 0;
+
+	offsets = xalloc(uint32_t, section->relocCount);
+
+	for (int i = 0; i < section->relocCount; ++i)
+	{
+		const AHPReloc* reloc = &section->relocs[i];
+
+		if (reloc->kind == AHPRelocKind_Absolute && reloc->width == 4)
+			offsets[tot++] = reloc->offset;
+	}
+
+	qsort(offsets, tot, sizeof(uint32_t), compareU32);
+
+	*count = tot;
+
+	return offsets;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const AHPSymbolInfo* ahp_find_symbol(const AHPSection* section, uint32_t offset)
+{
+	int low = 0, high = section->symbolCount;
+
+	// first symbol with an address above offset
+
+	while (low < high)
+	{
+		const int mid = (low + high) / 2;
+
+		if (section->symbols[mid].address <= offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low > 0 ? &section->symbols[low - 1] : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_find_line(const AHPSection* section, uint32_t offset, const char** filename, int* line)
+{
+	uint32_t bestAddress = 0;
+	int found = 0;
+
+	for (int dli = 0; dli < section->debugLineCount; ++dli)
+	{
+		const AHPLineInfo* lineInfo = &section->debugLines[dli];
+		int low = 0, high = lineInfo->count;
+
+		if (offset < lineInfo->baseOffset)
+			continue;
+
+		const uint32_t address = offset - lineInfo->baseOffset;
+
+		while (low < high)
+		{
+			const int mid = (low + high) / 2;
+
+			if (lineInfo->addresses[mid] <= address)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		if (low == 0)
+			continue;
+
+		const uint32_t lineAddress = lineInfo->baseOffset + lineInfo->addresses[low - 1];
+
+		if (!found || lineAddress > bestAddress)
+		{
+			bestAddress = lineAddress;
+			*filename = lineInfo->filename;
+			*line = lineInfo->lines[low - 1];
+			found = 1;
+		}
+	}
+
+	return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 static const char* getTypeName(AHPSectionType type)
 {
 	switch (type)
@@ -668,6 +1009,22 @@ void ahp_print_info(AHPInfo* info, int verbose)
 
 void ahp_free(AHPInfo* info)
 {
+	for (int si = 0; si < info->sectionCount && info->sections; ++si)
+	{
+		AHPSection* section = &info->sections[si];
+
+		for (int dli = 0; dli < section->debugLineCount; ++dli)
+		{
+			free(section->debugLines[dli].addresses);
+			free(section->debugLines[dli].lines);
+		}
+
+		free(section->debugLines);
+		free(section->debugBlocks);
+		free(section->relocs);
+		free(section->symbols);
+	}
+
 	free(info->sections);
 	free(info->fileData);
 	free(info);
@@ -26,7 +26,7 @@ typedef enum AHPSectionType
 typedef struct AHPSymbolInfo
 {
 	const char* name;
-	uint32_t address;
+	uint32_t address;	// byte offset in the section
 
 } AHPSymbolInfo;
 
@@ -37,15 +37,46 @@ typedef struct AHPLineInfo
 	const char* filename;
 	int count;
 
-	uint32_t baseOffset;
+	uint32_t baseOffset;	// byte offset in the section that addresses are relative to
 
-	uint32_t* addresses;
+	uint32_t* addresses;	// sorted, the file order is kept for lines at the same address
 	int* lines;
 
 } AHPLineInfo;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+typedef enum AHPRelocKind
+{
+	AHPRelocKind_Absolute,		// RELOC32, RELOC32SHORT, ABSRELOC16
+	AHPRelocKind_PcRelative,	// RELOC16, RELOC8, RELRELOC32
+	AHPRelocKind_DataRelative,	// DREL16, DREL8 (small data, relative to the data base register)
+} AHPRelocKind;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One entry per relocation, whatever hunk type it came from
+
+typedef struct AHPReloc
+{
+	uint32_t offset;	// where in the section the value is patched
+	uint16_t target;	// hunk the value refers to, files with more than 65535 hunks are rejected
+	uint8_t kind;		// AHPRelocKind
+	uint8_t width;		// bytes patched: 4, 2 or 1
+
+} AHPReloc;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HUNK_DEBUG data in other formats than LINE (stabs etc) is only located during parsing, see amiga_hunk_stabs.h
+
+typedef struct AHPDebugBlock
+{
+	uint32_t start;	// offset in the file of the data following the hunk length
+	uint32_t size;
+
+} AHPDebugBlock;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 typedef struct AHPSection
 {
     AHPSectionType type;
@@ -60,9 +91,15 @@ typedef struct AHPSection
     int relocCount;
     int symbolCount;
     int debugLineCount;
+    int debugBlockCount;
 
     AHPSymbolInfo* symbols;
     AHPLineInfo* debugLines;
+    AHPDebugBlock* debugBlocks;
+    AHPReloc* relocs;
+
+    uint32_t hunkStart; // extent of the hunks for this section in the file, up to and including HUNK_END
+    uint32_t hunkSize;
 
 } AHPSection;
 
@@ -82,6 +119,24 @@ typedef struct AHPInfo
 
 AHPInfo* ahp_parse_file(const char* filename);
 
+// Parses a rebuilt version of an already parsed executable. Sections whose hunks are byte for byte the same as in
+// prev aren't parsed again, their symbols, line info and relocation data are moved over from prev instead.
+// On success prev is freed and must not be used anymore, on failure 0 is returned and prev is untouched.
+AHPInfo* ahp_reparse(AHPInfo* prev, const char* filename);
+
+// Returns the offsets of all 32-bit absolute relocations of the section in ascending order (free with free())
+uint32_t* ahp_get_reloc_offsets(const AHPInfo* info, const AHPSection* section, int* count);
+
+// Hash of the bytes in the extent of the section's hunks, the same on all hosts. It isn't computed while parsing,
+// every call goes over the whole extent.
+uint64_t ahp_section_hash(const AHPInfo* info, const AHPSection* section);
+
+// Symbol that covers offset (the closest one at or before it), 0 if there is none
+const AHPSymbolInfo* ahp_find_symbol(const AHPSection* section, uint32_t offset);
+
+// Source file and line for offset, returns 0 if the section has no line info covering it
+int ahp_find_line(const AHPSection* section, uint32_t offset, const char** filename, int* line);
+
 void ahp_print_info(AHPInfo* info, int verbose);
 void ahp_free(AHPInfo* info);
 
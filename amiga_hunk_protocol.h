@@ -0,0 +1,71 @@
+#ifndef AMIGA_HUNK_PROTOCOL_
+#define AMIGA_HUNK_PROTOCOL_
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Wire format between the symbolization daemon (ahpd) and amiga_hunk_client. Client and daemon always run on the
+// same machine so everything is in host byte order.
+//
+// Request:  AHPRequestHeader, path (pathLength bytes, no terminator), count * AHPQuery
+// Response: AHPResponseHeader, count * AHPQueryReply, string table (stringSize bytes)
+
+#define AHP_PROTOCOL_MAGIC 0x41485031 // 'AHP1'
+#define AHP_SOCKET_NAME "ahpd.sock"	// in the directory picked by ahp_client_socket_path
+
+#define AHP_MAX_PATH_LENGTH 4096
+#define AHP_MAX_QUERIES (1 << 20)
+#define AHP_NO_STRING 0xffffffff
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef enum AHPStatus
+{
+	AHPStatus_Ok,
+	AHPStatus_BadRequest,
+	AHPStatus_ParseFailed,
+} AHPStatus;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPRequestHeader
+{
+	uint32_t magic;
+	uint32_t pathLength;
+	uint32_t count;
+
+} AHPRequestHeader;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPQuery
+{
+	uint32_t section;
+	uint32_t offset;
+
+} AHPQuery;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPResponseHeader
+{
+	uint32_t magic;
+	uint32_t status;
+	uint32_t count;
+	uint32_t stringSize;
+
+} AHPResponseHeader;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Strings are offsets into the string table, AHP_NO_STRING if there was no symbol/line info
+
+typedef struct AHPQueryReply
+{
+	uint32_t symbol;
+	uint32_t symbolOffset;	// offset from the start of the symbol
+	uint32_t filename;
+	uint32_t line;
+
+} AHPQueryReply;
+
+#endif
@@ -0,0 +1,496 @@
+#include "amiga_hunk_stabs.h"
+#include "endian.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define STABS_MAGIC 0x10b	// ZMAGIC
+#define NLIST_SIZE 12
+#define MAX_SCOPE_DEPTH 64
+#define NO_SCOPE 0xffffffff
+
+#define N_GSYM 0x20
+#define N_FUN 0x24
+#define N_STSYM 0x26
+#define N_LCSYM 0x28
+#define N_RSYM 0x40
+#define N_SLINE 0x44
+#define N_SO 0x64
+#define N_LSYM 0x80
+#define N_PSYM 0xa0
+#define N_LBRAC 0xc0
+#define N_RBRAC 0xe0
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Builder
+{
+	AHPStabsIndex* index;
+
+	uint32_t functionCapacity;
+	uint32_t scopeCapacity;
+	uint32_t variableCapacity;
+	uint32_t globalCapacity;
+
+	AHPStabsFunction* function;	// function being decoded, 0 outside of functions
+	uint32_t pendingVariables;	// first variable not yet assigned to a scope
+	uint32_t stack[MAX_SCOPE_DEPTH];
+	int depth;
+	int relative;				// block and line addresses are relative to the function, -1 until known
+
+} Builder;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void* grow(void* data, uint32_t* capacity, uint32_t count, size_t elementSize)
+{
+	if (count < *capacity)
+		return data;
+
+	*capacity = *capacity ? *capacity * 2 : 64;
+
+	return realloc(data, *capacity * elementSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint16_t nameLength(const char* stab)
+{
+	const char* colon = strchr(stab, ':');
+	const size_t length = colon ? (size_t)(colon - stab) : strlen(stab);
+
+	return length > 0xffff ? 0xffff : (uint16_t)length;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void addVariable(AHPStabsVariable** variables, uint32_t* count, uint32_t* capacity,
+						uint32_t stab, const char* string, AHPVariableKind kind, uint32_t value)
+{
+	*variables = (AHPStabsVariable*)grow(*variables, capacity, *count, sizeof(AHPStabsVariable));
+
+	AHPStabsVariable* variable = &(*variables)[(*count)++];
+
+	variable->stab = stab;
+	variable->nameLength = nameLength(string);
+	variable->kind = (uint16_t)kind;
+	variable->value = (int32_t)value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t addScope(Builder* builder, uint32_t start, uint32_t parent)
+{
+	AHPStabsIndex* index = builder->index;
+
+	index->scopes = (AHPStabsScope*)grow(index->scopes, &builder->scopeCapacity, index->scopeCount,
+										 sizeof(AHPStabsScope));
+
+	AHPStabsScope* scope = &index->scopes[index->scopeCount];
+
+	// variables are emitted before the N_LBRAC of the block they belong to
+
+	scope->start = start;
+	scope->end = 0;
+	scope->parent = parent;
+	scope->firstVariable = builder->pendingVariables;
+	scope->variableCount = index->variableCount - builder->pendingVariables;
+
+	builder->pendingVariables = index->variableCount;
+	builder->function->scopeCount++;
+
+	return index->scopeCount++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void closeFunction(Builder* builder)
+{
+	AHPStabsIndex* index = builder->index;
+	AHPStabsFunction* function = builder->function;
+
+	if (!function)
+		return;
+
+	// variables that never got a block belong to the function scope
+
+	AHPStabsScope* root = &index->scopes[function->firstScope];
+
+	if (function->scopeCount == 1)
+	{
+		root->variableCount += index->variableCount - builder->pendingVariables;
+		builder->pendingVariables = index->variableCount;
+	}
+	else if (root->variableCount == 0)
+	{
+		root->firstVariable = builder->pendingVariables;
+		root->variableCount = index->variableCount - builder->pendingVariables;
+		builder->pendingVariables = index->variableCount;
+	}
+
+	builder->function = 0;
+	builder->depth = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void openFunction(Builder* builder, uint32_t stab, const char* string, uint32_t start)
+{
+	AHPStabsIndex* index = builder->index;
+
+	closeFunction(builder);
+
+	index->functions = (AHPStabsFunction*)grow(index->functions, &builder->functionCapacity, index->functionCount,
+											   sizeof(AHPStabsFunction));
+
+	AHPStabsFunction* function = &index->functions[index->functionCount++];
+
+	function->stab = stab;
+	function->start = start;
+	function->end = 0;
+	function->firstScope = index->scopeCount;
+	function->scopeCount = 0;
+	function->nameLength = nameLength(string);
+
+	builder->function = function;
+	builder->pendingVariables = index->variableCount;
+	builder->stack[0] = addScope(builder, start, NO_SCOPE);
+	builder->depth = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parameters come right after N_FUN, but locals of the outermost block can be pending before its N_LBRAC, so the
+// parameter is moved in front of those to keep the variables of the function scope together
+
+static void addParam(Builder* builder, uint32_t stab, const char* string, uint32_t value)
+{
+	AHPStabsIndex* index = builder->index;
+	AHPStabsFunction* function = builder->function;
+
+	addVariable(&index->variables, &index->variableCount, &builder->variableCapacity,
+				stab, string, AHPVariableKind_Param, value);
+
+	// a block has taken the pending variables already, leave it to the next one as before
+
+	if (function->scopeCount != 1)
+		return;
+
+	AHPStabsVariable* variables = index->variables;
+	const uint32_t pending = builder->pendingVariables;
+	const uint32_t locals = index->variableCount - 1 - pending;
+	const AHPStabsVariable param = variables[pending + locals];
+
+	memmove(&variables[pending + 1], &variables[pending], locals * sizeof(AHPStabsVariable));
+	variables[pending] = param;
+
+	index->scopes[function->firstScope].variableCount++;
+	builder->pendingVariables++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Whether block addresses are absolute or relative to the function depends on the toolchain, so it's decided once per
+// compilation unit from the first line or block address in a function that doesn't start at 0 (where both read the
+// same). A relative one is smaller than the start of the function, an absolute one can't be.
+
+static uint32_t blockAddress(Builder* builder, uint32_t value)
+{
+	const uint32_t start = builder->function->start;
+
+	if (builder->relative < 0 && start > 0)
+		builder->relative = value < start;
+
+	return builder->relative > 0 ? start + value : value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void decodeBlock(Builder* builder, const uint8_t* fileData, const AHPDebugBlock* block)
+{
+	AHPStabsIndex* index = builder->index;
+	const uint8_t* data = fileData + block->start;
+
+	if (block->size < 8 || ahp_load_be32(data) != STABS_MAGIC)
+		return;
+
+	const uint32_t symbolSize = ahp_load_be32(data + 4);
+
+	if (symbolSize > block->size - 8 || (symbolSize % NLIST_SIZE) != 0 || block->size - 8 - symbolSize < 4)
+		return;
+
+	// a.out string table, the size includes the size field itself and n_strx is relative to its start
+
+	const uint32_t stringStart = 8 + symbolSize;
+	uint32_t stringSize = ahp_load_be32(data + stringStart);
+
+	if (stringSize > block->size - stringStart)
+		stringSize = block->size - stringStart;
+
+	const char* strings = (const char*)data + stringStart;
+
+	builder->relative = -1;
+
+	for (uint32_t pos = 8; pos < stringStart; pos += NLIST_SIZE)
+	{
+		const uint32_t strx = ahp_load_be32(data + pos);
+		const uint8_t type = data[pos + 4] & 0xfe;
+		const uint32_t value = ahp_load_be32(data + pos + 8);
+
+		if (strx >= stringSize || !memchr(strings + strx, 0, stringSize - strx))
+			continue;
+
+		const char* string = strings + strx;
+		const uint32_t stab = block->start + stringStart + strx;
+		AHPStabsFunction* function = builder->function;
+
+		switch (type)
+		{
+			case N_FUN:
+			{
+				// an empty N_FUN ends the current function, the value is its size
+
+				if (string[0] == 0)
+				{
+					if (function)
+						function->end = function->start + value;
+
+					closeFunction(builder);
+				}
+				else
+				{
+					openFunction(builder, stab, string, value);
+				}
+
+				break;
+			}
+
+			case N_SO:
+			{
+				closeFunction(builder);
+				builder->relative = -1;
+				break;
+			}
+
+			case N_SLINE:
+			{
+				if (function)
+					blockAddress(builder, value);
+
+				break;
+			}
+
+			case N_LBRAC:
+			case N_RBRAC:
+			{
+				if (!function)
+					break;
+
+				const uint32_t address = blockAddress(builder, value);
+
+				if (type == N_LBRAC)
+				{
+					if (builder->depth < MAX_SCOPE_DEPTH)
+					{
+						const uint32_t scope = addScope(builder, address, builder->stack[builder->depth - 1]);
+						builder->stack[builder->depth++] = scope;
+					}
+				}
+				else if (builder->depth > 1)
+				{
+					index->scopes[builder->stack[--builder->depth]].end = address;
+				}
+
+				break;
+			}
+
+			case N_LSYM:
+			case N_PSYM:
+			case N_RSYM:
+			{
+				// N_LSYM outside of functions are type definitions
+
+				if (!function)
+					break;
+
+				if (type == N_PSYM)
+				{
+					addParam(builder, stab, string, value);
+					break;
+				}
+
+				const AHPVariableKind kind = type == N_LSYM ? AHPVariableKind_Local : AHPVariableKind_Register;
+
+				addVariable(&index->variables, &index->variableCount, &builder->variableCapacity,
+							stab, string, kind, value);
+				break;
+			}
+
+			case N_STSYM:
+			case N_LCSYM:
+			case N_GSYM:
+			{
+				const AHPVariableKind kind = type == N_GSYM ? AHPVariableKind_Global : AHPVariableKind_Static;
+
+				if (function && type != N_GSYM)
+					addVariable(&index->variables, &index->variableCount, &builder->variableCapacity,
+								stab, string, kind, value);
+				else
+					addVariable(&index->globals, &index->globalCount, &builder->globalCapacity,
+								stab, string, kind, value);
+				break;
+			}
+		}
+	}
+
+	closeFunction(builder);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareFunctions(const void* a, const void* b)
+{
+	const uint32_t va = ((const AHPStabsFunction*)a)->start;
+	const uint32_t vb = ((const AHPStabsFunction*)b)->start;
+	return (va > vb) - (va < vb);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPStabsIndex* ahp_stabs_index_build(const AHPInfo* info, int sectionIndex)
+{
+	const AHPSection* section = &info->sections[sectionIndex];
+	Builder builder;
+
+	if (section->debugBlockCount == 0)
+		return 0;
+
+	memset(&builder, 0, sizeof(builder));
+
+	AHPStabsIndex* index = (AHPStabsIndex*)calloc(1, sizeof(AHPStabsIndex));
+	index->strings = (const char*)info->fileData;
+	builder.index = index;
+
+	for (int i = 0; i < section->debugBlockCount; ++i)
+		decodeBlock(&builder, (const uint8_t*)info->fileData, &section->debugBlocks[i]);
+
+	if (index->functionCount == 0 && index->globalCount == 0)
+	{
+		ahp_stabs_index_free(index);
+		return 0;
+	}
+
+	qsort(index->functions, index->functionCount, sizeof(AHPStabsFunction), compareFunctions);
+
+	// functions without an explicit size end where the next one starts, blocks without N_RBRAC with the function
+
+	for (uint32_t i = 0; i < index->functionCount; ++i)
+	{
+		AHPStabsFunction* function = &index->functions[i];
+
+		if (function->end <= function->start)
+			function->end = i + 1 < index->functionCount ? index->functions[i + 1].start : (uint32_t)section->memSize;
+
+		AHPStabsScope* scopes = &index->scopes[function->firstScope];
+
+		scopes[0].start = function->start;
+		scopes[0].end = function->end;
+
+		for (uint32_t s = 1; s < function->scopeCount; ++s)
+		{
+			if (scopes[s].end <= scopes[s].start)
+				scopes[s].end = function->end;
+		}
+	}
+
+	return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_stabs_index_free(AHPStabsIndex* index)
+{
+	if (!index)
+		return;
+
+	free(index->functions);
+	free(index->scopes);
+	free(index->variables);
+	free(index->globals);
+	free(index);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const AHPStabsFunction* ahp_stabs_find_function(const AHPStabsIndex* index, uint32_t offset)
+{
+	uint32_t low = 0, high = index->functionCount;
+
+	while (low < high)
+	{
+		const uint32_t mid = (low + high) / 2;
+
+		if (index->functions[mid].start <= offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low == 0 || offset >= index->functions[low - 1].end)
+		return 0;
+
+	return &index->functions[low - 1];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const AHPStabsScope* ahp_stabs_find_scope(const AHPStabsIndex* index, uint32_t offset)
+{
+	const AHPStabsFunction* function = ahp_stabs_find_function(index, offset);
+	const AHPStabsScope* found = 0;
+
+	if (!function)
+		return 0;
+
+	// pre-order, so the last scope that contains offset is the innermost one
+
+	for (uint32_t i = 0; i < function->scopeCount; ++i)
+	{
+		const AHPStabsScope* scope = &index->scopes[function->firstScope + i];
+
+		if (offset >= scope->start && offset < scope->end)
+			found = scope;
+	}
+
+	return found;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const AHPStabsFunction* ahp_stabs_functions_in_range(const AHPStabsIndex* index, uint32_t start, uint32_t end,
+													 uint32_t* count)
+{
+	uint32_t low = 0, high = index->functionCount;
+
+	*count = 0;
+
+	// first function that ends after start
+
+	while (low < high)
+	{
+		const uint32_t mid = (low + high) / 2;
+
+		if (index->functions[mid].end <= start)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	uint32_t last = low;
+
+	while (last < index->functionCount && index->functions[last].start < end)
+		last++;
+
+	*count = last - low;
+
+	return *count ? &index->functions[low] : 0;
+}
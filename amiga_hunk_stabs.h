@@ -0,0 +1,97 @@
+#ifndef AMIGA_HUNK_STABS_
+#define AMIGA_HUNK_STABS_
+
+#include "amiga_hunk_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Function/scope/variable index built from the stabs debug info GCC based toolchains put in HUNK_DEBUG (an a.out
+// style symbol and string table behind a ZMAGIC id). The parser only records where these blocks are, the index is
+// built when it's asked for. All names are offsets into info->fileData so the AHPInfo must outlive the index.
+
+typedef enum AHPVariableKind
+{
+	AHPVariableKind_Local,		// N_LSYM, value is the frame offset
+	AHPVariableKind_Param,		// N_PSYM, value is the frame offset
+	AHPVariableKind_Register,	// N_RSYM, value is the register number
+	AHPVariableKind_Static,		// N_STSYM/N_LCSYM, value is the address
+	AHPVariableKind_Global,		// N_GSYM
+} AHPVariableKind;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPStabsVariable
+{
+	uint32_t stab;			// the full stab string ("name:type")
+	uint16_t nameLength;
+	uint16_t kind;
+	int32_t value;
+
+} AHPStabsVariable;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scopes of a function are stored in pre-order, the first one covers the whole function
+
+typedef struct AHPStabsScope
+{
+	uint32_t start;
+	uint32_t end;
+	uint32_t parent;		// scope index, ~0 for the function scope
+	uint32_t firstVariable;
+	uint32_t variableCount;
+
+} AHPStabsScope;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPStabsFunction
+{
+	uint32_t stab;
+	uint32_t start;
+	uint32_t end;
+	uint32_t firstScope;
+	uint16_t scopeCount;
+	uint16_t nameLength;
+
+} AHPStabsFunction;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPStabsIndex
+{
+	const char* strings;	// info->fileData
+
+	AHPStabsFunction* functions;	// sorted by start
+	AHPStabsScope* scopes;
+	AHPStabsVariable* variables;
+	AHPStabsVariable* globals;
+
+	uint32_t functionCount;
+	uint32_t scopeCount;
+	uint32_t variableCount;
+	uint32_t globalCount;
+
+} AHPStabsIndex;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Decodes the stabs blocks of a section, returns 0 if there are none
+AHPStabsIndex* ahp_stabs_index_build(const AHPInfo* info, int sectionIndex);
+void ahp_stabs_index_free(AHPStabsIndex* index);
+
+const AHPStabsFunction* ahp_stabs_find_function(const AHPStabsIndex* index, uint32_t offset);
+
+// Innermost scope containing offset, walk ->parent for the enclosing ones
+const AHPStabsScope* ahp_stabs_find_scope(const AHPStabsIndex* index, uint32_t offset);
+
+// Functions overlapping [start, end), returns the first one and the number of them in count
+const AHPStabsFunction* ahp_stabs_functions_in_range(const AHPStabsIndex* index, uint32_t start, uint32_t end,
+													 uint32_t* count);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline const char* ahp_stabs_string(const AHPStabsIndex* index, uint32_t stab)
+{
+	return index->strings + stab;
+}
+
+#endif
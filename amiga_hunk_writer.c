@@ -0,0 +1,442 @@
+#include "amiga_hunk_writer.h"
+#include "doshunks.h"
+#include "endian.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relocation hunk to use for each kind/width, the reverse of the table the parser decodes with. RELOC32 switches to
+// RELOC32SHORT when all offsets and targets fit in 16 bits, RELRELOC32 only exists in the short format.
+
+typedef struct RelocHunk
+{
+	uint32_t hunkType;
+	uint8_t kind;
+	uint8_t width;
+	uint8_t shortOnly;
+
+} RelocHunk;
+
+static const RelocHunk s_relocHunks[] =
+{
+	{ HUNK_RELOC32, AHPRelocKind_Absolute, 4, 0 },
+	{ HUNK_ABSRELOC16, AHPRelocKind_Absolute, 2, 0 },
+	{ HUNK_RELRELOC32, AHPRelocKind_PcRelative, 4, 1 },
+	{ HUNK_RELOC16, AHPRelocKind_PcRelative, 2, 0 },
+	{ HUNK_RELOC8, AHPRelocKind_PcRelative, 1, 0 },
+	{ HUNK_DREL16, AHPRelocKind_DataRelative, 2, 0 },
+	{ HUNK_DREL8, AHPRelocKind_DataRelative, 1, 0 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reserve(AHPWriter* writer, uint32_t size)
+{
+	if (AHP_LIKELY(writer->size + size <= writer->capacity))
+		return;
+
+	writer->capacity = (writer->size + size) * 2;
+	writer->data = (uint8_t*)realloc(writer->data, writer->capacity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The put functions expect the space to have been reserved already
+
+static inline void put_u32(AHPWriter* writer, uint32_t v)
+{
+	ahp_store_be32(writer->data + writer->size, v);
+	writer->size += 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void put_u16(AHPWriter* writer, uint16_t v)
+{
+	ahp_store_be16(writer->data + writer->size, v);
+	writer->size += 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void write_u32(AHPWriter* writer, uint32_t v)
+{
+	reserve(writer, 4);
+	put_u32(writer, v);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bytes padded with zeros to a longword boundary
+
+static void writePadded(AHPWriter* writer, const void* data, uint32_t size, uint32_t paddedSize)
+{
+	reserve(writer, paddedSize);
+	memcpy(writer->data + writer->size, data, size);
+	memset(writer->data + writer->size + size, 0, paddedSize - size);
+	writer->size += paddedSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Names are zero padded to whole longwords and always get at least one terminating zero
+
+static uint32_t nameLongs(const char* name)
+{
+	return (uint32_t)strlen(name) / 4 + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_writer_init(AHPWriter* writer, uint32_t sizeHint)
+{
+	writer->size = 0;
+	writer->capacity = sizeHint ? sizeHint : 4096;
+	writer->data = (uint8_t*)malloc(writer->capacity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_writer_free(AHPWriter* writer)
+{
+	free(writer->data);
+	writer->data = 0;
+	writer->size = writer->capacity = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t sectionFlags(const AHPSection* section)
+{
+	switch (section->target)
+	{
+		case AHPSectionTarget_Chip : return HUNKF_CHIP;
+		case AHPSectionTarget_Fast : return HUNKF_FAST;
+		default : return 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_write_header(AHPWriter* writer, const AHPInfo* info)
+{
+	reserve(writer, (5 + info->sectionCount) * 4);
+
+	put_u32(writer, HUNK_HEADER);
+	put_u32(writer, 0); // no resident libraries
+	put_u32(writer, (uint32_t)info->sectionCount);
+	put_u32(writer, 0);
+	put_u32(writer, (uint32_t)info->sectionCount - 1);
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+		put_u32(writer, (((uint32_t)section->memSize + 3) / 4) | sectionFlags(section));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareRelocs(const void* a, const void* b)
+{
+	const AHPReloc* ra = (const AHPReloc*)a;
+	const AHPReloc* rb = (const AHPReloc*)b;
+
+	if (ra->target != rb->target)
+		return ra->target < rb->target ? -1 : 1;
+
+	return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// relocs are sorted by target, each target becomes one run (several in the short format if there are more than 64k)
+
+static void writeRelocHunk(AHPWriter* writer, uint32_t hunkType, const AHPReloc* relocs, uint32_t count, int isShort)
+{
+	const uint32_t maxRun = isShort ? 0xffff : 0xffffffff;
+	uint32_t i = 0;
+
+	write_u32(writer, hunkType);
+
+	while (i < count)
+	{
+		uint32_t n = 1;
+
+		while (i + n < count && n < maxRun && relocs[i + n].target == relocs[i].target)
+			n++;
+
+		if (isShort)
+		{
+			reserve(writer, (n + 2) * 2);
+			put_u16(writer, (uint16_t)n);
+			put_u16(writer, relocs[i].target);
+
+			for (uint32_t r = 0; r < n; ++r)
+				put_u16(writer, (uint16_t)relocs[i + r].offset);
+		}
+		else
+		{
+			reserve(writer, (n + 2) * 4);
+			put_u32(writer, n);
+			put_u32(writer, relocs[i].target);
+
+			for (uint32_t r = 0; r < n; ++r)
+				put_u32(writer, relocs[i + r].offset);
+		}
+
+		i += n;
+	}
+
+	if (isShort)
+	{
+		reserve(writer, 4);
+		put_u16(writer, 0);
+
+		if (writer->size & 2)
+			put_u16(writer, 0);
+	}
+	else
+	{
+		write_u32(writer, 0);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relocations are usually in offset order already, so a stable counting sort on the target gives the runs directly.
+// Runs that still aren't in offset order are sorted on their own.
+
+static void sortByTarget(const AHPReloc* in, AHPReloc* out, uint32_t count, uint32_t targetCount)
+{
+	uint32_t* offsets = (uint32_t*)calloc(targetCount + 1, sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < count; ++i)
+		offsets[in[i].target + 1]++;
+
+	for (uint32_t t = 1; t <= targetCount; ++t)
+		offsets[t] += offsets[t - 1];
+
+	for (uint32_t i = 0; i < count; ++i)
+		out[offsets[in[i].target]++] = in[i];
+
+	free(offsets);
+
+	for (uint32_t i = 0; i < count;)
+	{
+		uint32_t n = 1, sorted = 1;
+
+		for (; i + n < count && out[i + n].target == out[i].target; ++n)
+			sorted &= out[i + n].offset > out[i + n - 1].offset;
+
+		if (!sorted)
+			qsort(&out[i], n, sizeof(AHPReloc), compareRelocs);
+
+		i += n;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int writeRelocs(AHPWriter* writer, const AHPSection* section)
+{
+	AHPReloc* relocs;
+	AHPReloc* sorted;
+	uint32_t written = 0;
+
+	if (section->relocCount == 0)
+		return 1;
+
+	relocs = (AHPReloc*)malloc(section->relocCount * sizeof(AHPReloc));
+	sorted = (AHPReloc*)malloc(section->relocCount * sizeof(AHPReloc));
+
+	for (size_t h = 0; h < sizeof(s_relocHunks) / sizeof(s_relocHunks[0]); ++h)
+	{
+		const RelocHunk* format = &s_relocHunks[h];
+		uint32_t count = 0, fitsShort = 1, targetCount = 0;
+
+		for (int i = 0; i < section->relocCount; ++i)
+		{
+			const AHPReloc* reloc = &section->relocs[i];
+
+			if (reloc->kind != format->kind || reloc->width != format->width)
+				continue;
+
+			if (reloc->target >= targetCount)
+				targetCount = reloc->target + 1u;
+
+			fitsShort &= reloc->offset <= 0xffff;
+			relocs[count++] = *reloc;
+		}
+
+		if (count == 0)
+			continue;
+
+		if (format->shortOnly && !fitsShort)
+		{
+			printf("Section too large for HUNK_RELRELOC32 (%u bytes)\n", (uint32_t)section->memSize);
+			free(sorted);
+			free(relocs);
+			return 0;
+		}
+
+		sortByTarget(relocs, sorted, count, targetCount);
+
+		if (format->hunkType == HUNK_RELOC32 && fitsShort)
+			writeRelocHunk(writer, HUNK_RELOC32SHORT, sorted, count, 1);
+		else
+			writeRelocHunk(writer, format->hunkType, sorted, count, format->shortOnly);
+
+		written += count;
+	}
+
+	free(sorted);
+	free(relocs);
+
+	if (written != (uint32_t)section->relocCount)
+	{
+		printf("Section has relocations that can't be written in the hunk format\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeSymbols(AHPWriter* writer, const AHPSection* section)
+{
+	if (section->symbolCount == 0)
+		return;
+
+	write_u32(writer, HUNK_SYMBOL);
+
+	for (int i = 0; i < section->symbolCount; ++i)
+	{
+		const AHPSymbolInfo* symbol = &section->symbols[i];
+		const uint32_t longs = nameLongs(symbol->name);
+
+		write_u32(writer, longs);
+		writePadded(writer, symbol->name, (uint32_t)strlen(symbol->name), longs * 4);
+		write_u32(writer, symbol->address);
+	}
+
+	write_u32(writer, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HUNK_DEBUG: size, base offset, 'LINE', filename, then (line, offset) pairs
+
+static void writeLines(AHPWriter* writer, const AHPSection* section)
+{
+	for (int i = 0; i < section->debugLineCount; ++i)
+	{
+		const AHPLineInfo* lineInfo = &section->debugLines[i];
+		const uint32_t longs = nameLongs(lineInfo->filename);
+
+		reserve(writer, (5 + lineInfo->count * 2) * 4);
+
+		put_u32(writer, HUNK_DEBUG);
+		put_u32(writer, 3 + longs + lineInfo->count * 2);
+		put_u32(writer, lineInfo->baseOffset);
+		put_u32(writer, 0x4c494e45); // 'LINE'
+		put_u32(writer, longs);
+
+		writePadded(writer, lineInfo->filename, (uint32_t)strlen(lineInfo->filename), longs * 4);
+
+		reserve(writer, lineInfo->count * 8);
+
+		for (int l = 0; l < lineInfo->count; ++l)
+		{
+			put_u32(writer, (uint32_t)lineInfo->lines[l]);
+			put_u32(writer, lineInfo->addresses[l]);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// HUNK_DEBUG blocks in other formats (stabs etc) are copied as they are
+
+static void writeDebugBlocks(AHPWriter* writer, const AHPInfo* info, const AHPSection* section)
+{
+	for (int i = 0; i < section->debugBlockCount; ++i)
+	{
+		const AHPDebugBlock* block = &section->debugBlocks[i];
+
+		reserve(writer, 8);
+		put_u32(writer, HUNK_DEBUG);
+		put_u32(writer, block->size / 4);
+
+		writePadded(writer, (const uint8_t*)info->fileData + block->start, block->size, block->size);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_write_section(AHPWriter* writer, const AHPInfo* info, int sectionIndex)
+{
+	const AHPSection* section = &info->sections[sectionIndex];
+
+	if (section->type == AHPSectionType_Bss)
+	{
+		reserve(writer, 8);
+		put_u32(writer, HUNK_BSS);
+		put_u32(writer, ((uint32_t)section->memSize + 3) / 4);
+	}
+	else
+	{
+		const uint32_t dataLongs = ((uint32_t)section->dataSize + 3) / 4;
+
+		reserve(writer, 8);
+		put_u32(writer, section->type == AHPSectionType_Code ? HUNK_CODE : HUNK_DATA);
+		put_u32(writer, dataLongs);
+
+		writePadded(writer, (const uint8_t*)info->fileData + section->dataStart, (uint32_t)section->dataSize,
+					dataLongs * 4);
+	}
+
+	if (!writeRelocs(writer, section))
+		return 0;
+
+	writeSymbols(writer, section);
+	writeLines(writer, section);
+	writeDebugBlocks(writer, info, section);
+
+	write_u32(writer, HUNK_END);
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_write_info(AHPWriter* writer, const AHPInfo* info)
+{
+	ahp_write_header(writer, info);
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		if (!ahp_write_section(writer, info, i))
+			return 0;
+	}
+
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ahp_writer_save(const AHPWriter* writer, const char* filename)
+{
+	FILE* f = fopen(filename, "wb");
+
+	if (!f)
+	{
+		printf("Unable to open %s for writing\n", filename);
+		return 0;
+	}
+
+	const int result = fwrite(writer->data, 1, writer->size, f) == writer->size;
+
+	if (fclose(f) != 0 || !result)
+	{
+		printf("Unable to write %s\n", filename);
+		return 0;
+	}
+
+	return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef AMIGA_HUNK_WRITER_
+#define AMIGA_HUNK_WRITER_
+
+#include "amiga_hunk_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writes executables in the hunk format from the same AHPInfo/AHPSection model the parser produces, so anything that
+// can build an AHPInfo (a converter, a tool that patches a parsed file) can emit it. Section data is taken from
+// info->fileData + dataStart. The whole file is built in memory and written out with a single write.
+
+typedef struct AHPWriter
+{
+	uint8_t* data;
+	uint32_t size;
+	uint32_t capacity;
+
+} AHPWriter;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_writer_init(AHPWriter* writer, uint32_t sizeHint);
+void ahp_writer_free(AHPWriter* writer);
+
+// HUNK_HEADER followed by every section, returns 0 if a section has relocations that can't be encoded
+int ahp_write_info(AHPWriter* writer, const AHPInfo* info);
+
+// Building blocks for ahp_write_info, a section is its data hunk, relocations, symbols, debug info and HUNK_END
+void ahp_write_header(AHPWriter* writer, const AHPInfo* info);
+int ahp_write_section(AHPWriter* writer, const AHPInfo* info, int sectionIndex);
+
+int ahp_writer_save(const AHPWriter* writer, const char* filename);
+
+#endif
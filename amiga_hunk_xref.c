@@ -0,0 +1,452 @@
+#include "amiga_hunk_xref.h"
+#include "endian.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct FanIn
+{
+	uint32_t count;
+	uint32_t node;
+
+} FanIn;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int isAbsolute32(const AHPReloc* reloc)
+{
+	return reloc->kind == AHPRelocKind_Absolute && reloc->width == 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A node per distinct symbol address, and one for the bytes before the first symbol unless it starts the section
+
+static uint32_t countNodes(const AHPSection* section)
+{
+	uint32_t count = section->symbolCount == 0 || section->symbols[0].address != 0 ? 1 : 0;
+
+	for (int i = 0; i < section->symbolCount; ++i)
+	{
+		if (i == 0 || section->symbols[i].address != section->symbols[i - 1].address)
+			count++;
+	}
+
+	return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static AHPXrefNode* addNodes(AHPXrefNode* node, const AHPSection* section, uint32_t sectionIndex)
+{
+	if (section->symbolCount == 0 || section->symbols[0].address != 0)
+	{
+		node->start = 0;
+		node->section = sectionIndex;
+		node->firstSymbol = 0;
+		node->symbolCount = 0;
+		node++;
+	}
+
+	for (int i = 0; i < section->symbolCount; ++i)
+	{
+		if (i > 0 && section->symbols[i].address == section->symbols[i - 1].address)
+		{
+			node[-1].symbolCount++;
+			continue;
+		}
+
+		node->start = section->symbols[i].address;
+		node->section = sectionIndex;
+		node->firstSymbol = (uint32_t)i;
+		node->symbolCount = 1;
+		node++;
+	}
+
+	return node;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relocated longword, BSS and the part of a section past its data are zero
+
+static uint32_t readValue(const AHPInfo* info, const AHPSection* section, uint32_t offset)
+{
+	if ((uint64_t)offset + 4 > (uint64_t)section->dataSize)
+		return 0;
+
+	return ahp_load_be32((const uint8_t*)info->fileData + section->dataStart + offset);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void setBucketSize(AHPXrefSection* section, const AHPSection* source, uint32_t nodeCount)
+{
+	const uint32_t size = (uint32_t)source->memSize;
+	uint32_t shift = 2;
+
+	while (shift < 31 && (size >> shift) > nodeCount * 2)
+		shift++;
+
+	section->bucketShift = shift;
+	section->bucketCount = (size >> shift) + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void fillBuckets(AHPXref* xref, uint32_t sectionIndex)
+{
+	const AHPXrefSection* section = &xref->sections[sectionIndex];
+	uint32_t* buckets = xref->buckets + section->firstBucket;
+	uint32_t node = section->firstNode;
+
+	for (uint32_t b = 0; b < section->bucketCount; ++b)
+	{
+		const uint64_t start = (uint64_t)b << section->bucketShift;
+
+		while (node + 1 < section[1].firstNode && xref->nodes[node + 1].start <= start)
+			node++;
+
+		buckets[b] = node;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t ahp_xref_find_node(const AHPXref* xref, int sectionIndex, uint32_t offset)
+{
+	const AHPXrefSection* section = &xref->sections[sectionIndex];
+	uint32_t bucket = offset >> section->bucketShift;
+
+	// addresses past the end of the section belong to its last node
+
+	if (bucket >= section->bucketCount)
+		bucket = section->bucketCount - 1;
+
+	const uint32_t* buckets = xref->buckets + section->firstBucket;
+	uint32_t low = buckets[bucket];
+	uint32_t high = bucket + 1 < section->bucketCount ? buckets[bucket + 1] + 1 : section[1].firstNode;
+
+	// first node starting above offset, the one before it contains offset (the bucket's node starts at or before it)
+
+	while (low < high)
+	{
+		const uint32_t mid = low + (high - low) / 2;
+
+		if (xref->nodes[mid].start <= offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Counting sort of the edges on their sources into rows
+
+static void buildRows(AHPXref* xref, const uint32_t* edgeSources, const uint32_t* edgeTargets)
+{
+	uint32_t* cursor = xref->firstOut;
+
+	for (uint32_t e = 0; e < xref->edgeCount; ++e)
+		cursor[edgeSources[e] + 1]++;
+
+	for (uint32_t n = 0; n < xref->nodeCount; ++n)
+		cursor[n + 1] += cursor[n];
+
+	// fill with firstOut[n] as the write position of row n, afterwards it has moved to the start of row n + 1
+
+	for (uint32_t e = 0; e < xref->edgeCount; ++e)
+		xref->targets[cursor[edgeSources[e]]++] = edgeTargets[e];
+
+	memmove(cursor + 1, cursor, xref->nodeCount * sizeof(uint32_t));
+	cursor[0] = 0;
+
+	// the reverse rows are filled walking the forward ones in node order so the sources of each row come out sorted
+
+	cursor = xref->firstIn;
+
+	for (uint32_t e = 0; e < xref->edgeCount; ++e)
+		cursor[xref->targets[e] + 1]++;
+
+	for (uint32_t n = 0; n < xref->nodeCount; ++n)
+		cursor[n + 1] += cursor[n];
+
+	for (uint32_t n = 0; n < xref->nodeCount; ++n)
+	{
+		for (uint32_t e = xref->firstOut[n]; e < xref->firstOut[n + 1]; ++e)
+			xref->sources[cursor[xref->targets[e]]++] = n;
+	}
+
+	memmove(cursor + 1, cursor, xref->nodeCount * sizeof(uint32_t));
+	cursor[0] = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPXref* ahp_xref_build(const AHPInfo* info)
+{
+	AHPXref* xref = calloc(1, sizeof(AHPXref));
+	uint32_t* edgeSources = 0;
+	uint32_t* edgeTargets = 0;
+	uint32_t edge = 0;
+
+	if (!xref)
+		return 0;
+
+	xref->sectionCount = (uint32_t)info->sectionCount;
+	xref->sections = calloc(xref->sectionCount + 1, sizeof(AHPXrefSection));
+
+	if (!xref->sections)
+		goto fail;
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+
+		const uint32_t nodeCount = countNodes(section);
+
+		xref->sections[i].firstNode = xref->nodeCount;
+		xref->sections[i].firstBucket = xref->bucketCount;
+		setBucketSize(&xref->sections[i], section, nodeCount);
+
+		xref->nodeCount += nodeCount;
+		xref->bucketCount += xref->sections[i].bucketCount;
+
+		for (int r = 0; r < section->relocCount; ++r)
+			xref->edgeCount += isAbsolute32(&section->relocs[r]);
+	}
+
+	xref->sections[xref->sectionCount].firstNode = xref->nodeCount;
+
+	xref->nodes = malloc(xref->nodeCount * sizeof(AHPXrefNode) + 1);
+	xref->buckets = malloc(xref->bucketCount * sizeof(uint32_t) + 1);
+	xref->firstOut = calloc(xref->nodeCount + 1, sizeof(uint32_t));
+	xref->firstIn = calloc(xref->nodeCount + 1, sizeof(uint32_t));
+	xref->targets = malloc(xref->edgeCount * sizeof(uint32_t) + 1);
+	xref->sources = malloc(xref->edgeCount * sizeof(uint32_t) + 1);
+	edgeSources = malloc(xref->edgeCount * sizeof(uint32_t) + 1);
+	edgeTargets = malloc(xref->edgeCount * sizeof(uint32_t) + 1);
+
+	if (!xref->nodes || !xref->buckets || !xref->firstOut || !xref->firstIn || !xref->targets || !xref->sources ||
+		!edgeSources || !edgeTargets)
+	{
+		printf("Out of memory building the reference graph (%u nodes, %u references)\n", xref->nodeCount,
+			   xref->edgeCount);
+		goto fail;
+	}
+
+	AHPXrefNode* node = xref->nodes;
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		node = addNodes(node, &info->sections[i], (uint32_t)i);
+		fillBuckets(xref, (uint32_t)i);
+	}
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+
+		for (int r = 0; r < section->relocCount; ++r)
+		{
+			const AHPReloc* reloc = &section->relocs[r];
+
+			if (!isAbsolute32(reloc))
+				continue;
+
+			const uint32_t value = readValue(info, section, reloc->offset);
+
+			edgeSources[edge] = ahp_xref_find_node(xref, i, reloc->offset);
+			edgeTargets[edge] = ahp_xref_find_node(xref, reloc->target, value);
+			edge++;
+		}
+	}
+
+	buildRows(xref, edgeSources, edgeTargets);
+
+	free(edgeSources);
+	free(edgeTargets);
+
+	return xref;
+
+fail:
+
+	free(edgeSources);
+	free(edgeTargets);
+	ahp_xref_free(xref);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_xref_free(AHPXref* xref)
+{
+	if (!xref)
+		return;
+
+	free(xref->nodes);
+	free(xref->sections);
+	free(xref->buckets);
+	free(xref->firstOut);
+	free(xref->targets);
+	free(xref->firstIn);
+	free(xref->sources);
+	free(xref);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t* ahp_xref_reachable(const AHPXref* xref, uint32_t root)
+{
+	uint8_t* reached = calloc(xref->nodeCount + 1, 1);
+	uint32_t* queue = malloc((xref->nodeCount + 1) * sizeof(uint32_t));
+	uint32_t head = 0, tail = 0;
+
+	if (!reached || !queue || root >= xref->nodeCount)
+	{
+		free(queue);
+		return reached;
+	}
+
+	reached[root] = 1;
+	queue[tail++] = root;
+
+	while (head < tail)
+	{
+		const uint32_t node = queue[head++];
+
+		for (uint32_t e = xref->firstOut[node]; e < xref->firstOut[node + 1]; ++e)
+		{
+			const uint32_t target = xref->targets[e];
+
+			if (!reached[target])
+			{
+				reached[target] = 1;
+				queue[tail++] = target;
+			}
+		}
+	}
+
+	free(queue);
+
+	return reached;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t nodeEnd(const AHPXref* xref, const AHPInfo* info, uint32_t node)
+{
+	const AHPXrefNode* n = &xref->nodes[node];
+
+	if (node + 1 < xref->sections[n->section + 1].firstNode)
+		return n[1].start;
+
+	return (uint32_t)info->sections[n->section].memSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printNode(const AHPXref* xref, const AHPInfo* info, uint32_t node)
+{
+	const AHPXrefNode* n = &xref->nodes[node];
+	const uint32_t end = nodeEnd(xref, info, node);
+
+	printf("%3u  %08x  %8u  ", n->section, n->start, end > n->start ? end - n->start : 0);
+
+	if (n->symbolCount == 0)
+		printf("<start of section>");
+	else
+		printf("%s", info->sections[n->section].symbols[n->firstSymbol].name);
+
+	if (n->symbolCount > 1)
+		printf(" (+%u aliases)", n->symbolCount - 1);
+
+	printf("\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compareFanIn(const void* a, const void* b)
+{
+	const FanIn* fa = (const FanIn*)a;
+	const FanIn* fb = (const FanIn*)b;
+
+	if (fa->count != fb->count)
+		return fa->count < fb->count ? 1 : -1;
+
+	return (fa->node > fb->node) - (fa->node < fb->node);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ahp_xref_print(const AHPXref* xref, const AHPInfo* info, int maxFanIn)
+{
+	uint32_t unreachableCount = 0, fanInCount = 0;
+	uint64_t unreachableSize = 0; // sections can add up to more than 4 GB
+
+	if (xref->nodeCount == 0)
+		return;
+
+	uint8_t* reached = ahp_xref_reachable(xref, ahp_xref_find_node(xref, 0, 0));
+	FanIn* fanIns = malloc(xref->nodeCount * sizeof(FanIn));
+
+	if (!reached || !fanIns)
+	{
+		free(reached);
+		free(fanIns);
+		return;
+	}
+
+	printf("Not reachable from offset 0 of section 0 through absolute references:\n\n");
+	printf("Sec  Offset    Size      Name\n");
+
+	for (uint32_t n = 0; n < xref->nodeCount; ++n)
+	{
+		if (reached[n])
+			continue;
+
+		const uint32_t end = nodeEnd(xref, info, n);
+
+		printNode(xref, info, n);
+		unreachableCount++;
+		unreachableSize += end > xref->nodes[n].start ? end - xref->nodes[n].start : 0;
+	}
+
+	printf("\n%u nodes, %u references, %u unreachable (%llu bytes)\n", xref->nodeCount, xref->edgeCount,
+		   unreachableCount, (unsigned long long)unreachableSize);
+
+	for (uint32_t n = 0; n < xref->nodeCount; ++n)
+	{
+		if (ahp_xref_fan_in(xref, n) > 0)
+		{
+			fanIns[fanInCount].count = ahp_xref_fan_in(xref, n);
+			fanIns[fanInCount].node = n;
+			fanInCount++;
+		}
+	}
+
+	qsort(fanIns, fanInCount, sizeof(FanIn), compareFanIn);
+
+	printf("\nMost referenced:\n\n");
+	printf("Refs      From      Sec  Offset    Size      Name\n");
+
+	for (uint32_t i = 0; i < fanInCount && i < (uint32_t)maxFanIn; ++i)
+	{
+		const uint32_t node = fanIns[i].node;
+		uint32_t from = 0;
+
+		// sources are sorted, count the distinct nodes referring to this one
+
+		for (uint32_t e = xref->firstIn[node]; e < xref->firstIn[node + 1]; ++e)
+			from += e == xref->firstIn[node] || xref->sources[e] != xref->sources[e - 1];
+
+		printf("%8u  %8u  ", fanIns[i].count, from);
+		printNode(xref, info, node);
+	}
+
+	free(fanIns);
+	free(reached);
+}
@@ -0,0 +1,87 @@
+#ifndef AMIGA_HUNK_XREF_
+#define AMIGA_HUNK_XREF_
+
+#include "amiga_hunk_parser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cross reference graph built from the 32-bit absolute relocations (RELOC32, RELOC32SHORT). Every relocated longword
+// is an edge from the node that contains it to the node that contains the address stored in it. Nodes are the
+// symbols of each section (symbols at the same address are one node) plus a node for the bytes before the first
+// symbol, so every offset belongs to a node.
+//
+// PC relative references (bsr, lea label(pc), ...) aren't relocated and aren't in the graph. With the small code
+// model most calls inside a hunk go that way, so "unreachable" means not reachable through absolute references.
+//
+// Edges are stored in compressed sparse row form in both directions: the targets of node n are
+// targets[firstOut[n]] up to targets[firstOut[n + 1]] and the nodes referring to it are sources[firstIn[n]] up to
+// sources[firstIn[n + 1]], the latter sorted so repeated references from the same node are next to each other.
+
+typedef struct AHPXrefNode
+{
+	uint32_t start;			// offset in the section, the node ends where the next one in the section starts
+	uint32_t section;
+	uint32_t firstSymbol;	// index into section->symbols
+	uint32_t symbolCount;	// 0 for the unnamed node at the start of a section
+
+} AHPXrefNode;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Offsets are mapped to nodes through buckets of 1 << bucketShift bytes that hold the node containing the start of
+// the bucket, the shift is picked so there are about two buckets per node and a lookup only searches a few nodes
+
+typedef struct AHPXrefSection
+{
+	uint32_t firstNode;
+	uint32_t firstBucket;
+	uint32_t bucketCount;
+	uint32_t bucketShift;
+
+} AHPXrefSection;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct AHPXref
+{
+	AHPXrefNode* nodes;			// grouped by section, sorted by start within a section
+	AHPXrefSection* sections;	// sectionCount + 1 entries, the last one only has firstNode set
+	uint32_t* buckets;
+	uint32_t* firstOut;			// nodeCount + 1 entries
+	uint32_t* targets;
+	uint32_t* firstIn;			// nodeCount + 1 entries
+	uint32_t* sources;
+
+	uint32_t nodeCount;
+	uint32_t edgeCount;
+	uint32_t sectionCount;
+	uint32_t bucketCount;
+
+} AHPXref;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AHPXref* ahp_xref_build(const AHPInfo* info);
+void ahp_xref_free(AHPXref* xref);
+
+// Node that contains offset in the section
+uint32_t ahp_xref_find_node(const AHPXref* xref, int sectionIndex, uint32_t offset);
+
+// One byte per node, set for the nodes that can be reached from root (root included). Free with free().
+uint8_t* ahp_xref_reachable(const AHPXref* xref, uint32_t root);
+
+// Lists the nodes that can't be reached from the entry point (offset 0 of the first section) and the maxFanIn
+// nodes with the most references to them
+void ahp_xref_print(const AHPXref* xref, const AHPInfo* info, int maxFanIn);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t ahp_xref_fan_in(const AHPXref* xref, uint32_t node)
+{
+	return xref->firstIn[node + 1] - xref->firstIn[node];
+}
+
+static inline uint32_t ahp_xref_fan_out(const AHPXref* xref, uint32_t node)
+{
+	return xref->firstOut[node + 1] - xref->firstOut[node];
+}
+
+#endif
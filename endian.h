@@ -1,6 +1,35 @@
 #pragma once
 
-#if defined (__GLIBC__)
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Host byte order detection
+
+#if defined (__AROS__)
+    #include <aros/cpu.h>
+    #if AROS_BIG_ENDIAN
+        #define AHP_BIG_ENDIAN
+        #define AHP_BYTE_ORDER 4321
+    #else
+        #define AHP_LITTLE_ENDIAN
+        #define AHP_BYTE_ORDER 1234
+    #endif
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && defined(__ORDER_BIG_ENDIAN__)
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	#define AHP_LITTLE_ENDIAN
+	#define AHP_BYTE_ORDER 1234
+#elif (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	#define AHP_BIG_ENDIAN
+	#define AHP_BYTE_ORDER 4321
+#else
+	#error "Unable to detect endian for your target."
+#endif
+#elif defined (__GLIBC__)
 #include <endian.h>
 #if (__BYTE_ORDER == __LITTLE_ENDIAN)
 	#define AHP_LITTLE_ENDIAN
@@ -9,7 +38,7 @@
 #elif (__BYTE_ORDER == __PDP_ENDIAN)
 	#define AHP_BIG_ENDIAN
 #else
-	#error Unknown machine endianness detected.
+	#error "Unable to detect endian for your target."
 #endif
 	#define AHP_BYTE_ORDER __BYTE_ORDER
 #elif defined(_BIG_ENDIAN)
@@ -31,9 +60,201 @@
    || defined(_M_ALPHA) || defined(__amd64) \
    || defined(__amd64__) || defined(_M_AMD64) \
    || defined(__x86_64) || defined(__x86_64__) \
-   || defined(_M_X64) || defined(__arm64__)
+   || defined(_M_X64) || defined(__arm64__) \
+   || defined(_M_ARM64)
 	#define AHP_LITTLE_ENDIAN
 	#define AHP_BYTE_ORDER 1234
 #else
 	#error "Unable to detect endian for your target."
 #endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define AHP_LIKELY(x) __builtin_expect(!!(x), 1)
+	#define AHP_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+	#define AHP_LIKELY(x) (x)
+	#define AHP_UNLIKELY(x) (x)
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint16_t ahp_bswap16(uint16_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap16(val);
+#elif defined(_MSC_VER)
+    return _byteswap_ushort(val);
+#else
+    return (uint16_t)((val << 8) | (val >> 8));
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t ahp_bswap32(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap32(val);
+#elif defined(_MSC_VER)
+    return _byteswap_ulong(val);
+#else
+    return ((val & 0x000000ff) << 24) |
+           ((val & 0x0000ff00) << 8) |
+           ((val & 0x00ff0000) >> 8) |
+           ((val & 0xff000000) >> 24);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Big endian loads from any (possibly unaligned) address. The memcpy is folded into a single load by the compiler
+// and together with the byteswap becomes one MOVBE on x86 targets that have it (-mmovbe / -march=native)
+
+static inline uint32_t ahp_load_be32(const void* ptr)
+{
+    uint32_t val;
+    memcpy(&val, ptr, sizeof(val));
+#if defined(AHP_LITTLE_ENDIAN)
+    return ahp_bswap32(val);
+#else
+    return val;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint16_t ahp_load_be16(const void* ptr)
+{
+    uint16_t val;
+    memcpy(&val, ptr, sizeof(val));
+#if defined(AHP_LITTLE_ENDIAN)
+    return ahp_bswap16(val);
+#else
+    return val;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void ahp_store_be32(void* ptr, uint32_t val)
+{
+#if defined(AHP_LITTLE_ENDIAN)
+    val = ahp_bswap32(val);
+#endif
+    memcpy(ptr, &val, sizeof(val));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void ahp_store_be16(void* ptr, uint16_t val)
+{
+#if defined(AHP_LITTLE_ENDIAN)
+    val = ahp_bswap16(val);
+#endif
+    memcpy(ptr, &val, sizeof(val));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bounds checked cursor over the file data. Reading past the end doesn't touch memory outside of the buffer, it
+// returns 0 and sets the sticky overrun flag instead, so callers only need to check it once per hunk.
+
+typedef struct AHPReader
+{
+	const uint8_t* data;
+	uint32_t size;
+	uint32_t index;
+	int overrun;
+
+} AHPReader;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void reader_init(AHPReader* reader, const void* data, uint32_t size)
+{
+	reader->data = (const uint8_t*)data;
+	reader->size = size;
+	reader->index = 0;
+	reader->overrun = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline int reader_has(const AHPReader* reader, uint32_t count)
+{
+	return reader->size - reader->index >= count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void reader_fail(AHPReader* reader)
+{
+	reader->index = reader->size;
+	reader->overrun = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void reader_skip(AHPReader* reader, uint32_t count)
+{
+	if (AHP_UNLIKELY(!reader_has(reader, count)))
+	{
+		reader_fail(reader);
+		return;
+	}
+
+	reader->index += count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void reader_seek(AHPReader* reader, uint32_t index)
+{
+	if (AHP_UNLIKELY(index > reader->size))
+	{
+		reader_fail(reader);
+		return;
+	}
+
+	reader->index = index;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t get_u32(const AHPReader* reader, uint32_t index)
+{
+	if (AHP_UNLIKELY(index > reader->size || reader->size - index < 4))
+		return 0;
+
+	return ahp_load_be32(reader->data + index);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint32_t get_u32_inc(AHPReader* reader)
+{
+	if (AHP_UNLIKELY(!reader_has(reader, 4)))
+	{
+		reader_fail(reader);
+		return 0;
+	}
+
+	uint32_t val = ahp_load_be32(reader->data + reader->index);
+	reader->index += 4;
+	return val;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline uint16_t get_u16_inc(AHPReader* reader)
+{
+	if (AHP_UNLIKELY(!reader_has(reader, 2)))
+	{
+		reader_fail(reader);
+		return 0;
+	}
+
+	uint16_t val = ahp_load_be16(reader->data + reader->index);
+	reader->index += 2;
+	return val;
+}
@@ -1,5 +1,219 @@
 #include "amiga_hunk_parser.h"
+#include "amiga_hunk_diff.h"
+#include "amiga_hunk_insn.h"
+#include "amiga_hunk_compact.h"
+#include "amiga_hunk_xref.h"
+#include "amiga_hunk_stabs.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int diffFiles(const char* filenameA, const char* filenameB)
+{
+	AHPInfo* a;
+	AHPInfo* b;
+
+	if (!(a = ahp_parse_file(filenameA)))
+		return 0;
+
+	if (!(b = ahp_parse_file(filenameB)))
+	{
+		ahp_free(a);
+		return 0;
+	}
+
+	AHPDiff* diff = ahp_diff(a, b);
+
+	ahp_diff_print(diff, a, b);
+
+	ahp_diff_free(diff);
+	ahp_free(b);
+	ahp_free(a);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int insnFile(const char* filename)
+{
+	AHPInfo* info;
+
+	if (!(info = ahp_parse_file(filename)))
+		return 0;
+
+	AHPInsnIndex* indices = (AHPInsnIndex*)calloc(info->sectionCount, sizeof(AHPInsnIndex));
+
+	ahp_insn_index_build_all(indices, info, AHPCpu_68020, 4);
+
+	printf("Sec  Size      Instructions\n");
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPInsnIndex* index = &indices[i];
+		uint32_t count = 0;
+
+		if (index->size == 0)
+			continue;
+
+		for (uint32_t offset = 0; offset < index->size; offset = ahp_insn_next(index, offset))
+			count++;
+
+		printf("%3d  %8u  %12u\n", i, index->size, count);
+	}
+
+	for (int i = 0; i < info->sectionCount; ++i)
+		ahp_insn_index_free(&indices[i]);
+
+	free(indices);
+	ahp_free(info);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory used by the arrays hanging off the sections of the parsed model, without the file they point into
+
+static size_t parsedSize(const AHPInfo* info)
+{
+	size_t size = sizeof(AHPInfo) + info->sectionCount * sizeof(AHPSection);
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		const AHPSection* section = &info->sections[i];
+
+		size += section->symbolCount * sizeof(AHPSymbolInfo);
+		size += section->debugLineCount * sizeof(AHPLineInfo);
+		size += section->debugBlockCount * sizeof(AHPDebugBlock);
+		size += section->relocCount * sizeof(AHPReloc);
+
+		for (int d = 0; d < section->debugLineCount; ++d)
+			size += section->debugLines[d].count * (sizeof(uint32_t) + sizeof(int));
+	}
+
+	return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int compactFile(const char* filename)
+{
+	AHPInfo* info;
+	AHPCompact* compact;
+
+	if (!(info = ahp_parse_file(filename)))
+		return 0;
+
+	if (!(compact = ahp_compact_create(info)))
+	{
+		ahp_free(info);
+		return 0;
+	}
+
+	// the parsed model keeps the whole file loaded as names and debug data point into it
+
+	size_t fileSize = 0;
+	FILE* f = fopen(filename, "rb");
+
+	if (f)
+	{
+		fseek(f, 0, SEEK_END);
+		fileSize = (size_t)ftell(f);
+		fclose(f);
+	}
+
+	printf("Parsed  %10u bytes (arrays only)\n", (uint32_t)parsedSize(info));
+	printf("Parsed  %10u bytes (with the file)\n", (uint32_t)(parsedSize(info) + fileSize));
+	printf("Compact %10u bytes\n", compact->size);
+
+	free(compact);
+	ahp_free(info);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int xrefFile(const char* filename)
+{
+	AHPInfo* info;
+	AHPXref* xref;
+
+	if (!(info = ahp_parse_file(filename)))
+		return 0;
+
+	if ((xref = ahp_xref_build(info)))
+	{
+		ahp_xref_print(xref, info, 20);
+		ahp_xref_free(xref);
+	}
+
+	ahp_free(info);
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void printStabsFunction(const AHPStabsIndex* index, const AHPStabsFunction* function)
+{
+	static const char* kindNames[] = { "local", "param", "register", "static", "global" };
+
+	printf("%08x-%08x %.*s\n", function->start, function->end, function->nameLength,
+		   ahp_stabs_string(index, function->stab));
+
+	for (uint32_t s = 0; s < function->scopeCount; ++s)
+	{
+		const AHPStabsScope* scope = &index->scopes[function->firstScope + s];
+		int depth = 0;
+
+		for (uint32_t parent = scope->parent; parent != 0xffffffff; parent = index->scopes[parent].parent)
+			depth++;
+
+		printf("%*s{ %08x-%08x\n", depth * 2 + 2, "", scope->start, scope->end);
+
+		for (uint32_t v = 0; v < scope->variableCount; ++v)
+		{
+			const AHPStabsVariable* variable = &index->variables[scope->firstVariable + v];
+
+			printf("%*s%.*s (%s %d)\n", depth * 2 + 4, "", variable->nameLength,
+				   ahp_stabs_string(index, variable->stab), kindNames[variable->kind], variable->value);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int stabsFile(const char* filename)
+{
+	AHPInfo* info;
+
+	if (!(info = ahp_parse_file(filename)))
+		return 0;
+
+	for (int i = 0; i < info->sectionCount; ++i)
+	{
+		AHPStabsIndex* index = ahp_stabs_index_build(info, i);
+
+		if (!index)
+			continue;
+
+		printf("Section %d: %u functions, %u globals\n\n", i, index->functionCount, index->globalCount);
+
+		for (uint32_t f = 0; f < index->functionCount; ++f)
+			printStabsFunction(index, &index->functions[f]);
+
+		printf("\n");
+
+		ahp_stabs_index_free(index);
+	}
+
+	ahp_free(info);
+
+	return 0;
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -9,10 +223,30 @@ int main(int argc, const char** argv)
 
     if (argc < 2)
     {
-        printf("Usage: %s <amiga executable>\n\n", argv[0]);
+        printf("Usage: %s <amiga executable>\n", argv[0]);
+        printf("       %s --diff <old executable> <new executable>\n", argv[0]);
+        printf("       %s --insn <amiga executable>\n", argv[0]);
+        printf("       %s --compact <amiga executable>\n", argv[0]);
+        printf("       %s --xref <amiga executable>\n", argv[0]);
+        printf("       %s --stabs <amiga executable>\n\n", argv[0]);
         return 0;
     }
 
+    if (!strcmp(argv[1], "--diff") && argc >= 4)
+    	return diffFiles(argv[2], argv[3]);
+
+    if (!strcmp(argv[1], "--insn") && argc >= 3)
+    	return insnFile(argv[2]);
+
+    if (!strcmp(argv[1], "--compact") && argc >= 3)
+    	return compactFile(argv[2]);
+
+    if (!strcmp(argv[1], "--xref") && argc >= 3)
+    	return xrefFile(argv[2]);
+
+    if (!strcmp(argv[1], "--stabs") && argc >= 3)
+    	return stabsFile(argv[2]);
+
     if (!(info = ahp_parse_file(argv[1])))
     	return 0;
 
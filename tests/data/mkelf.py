@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+# Writes the ELF fixtures used by tests/test_elf.c:
+#
+#   python3 tests/data/mkelf.py tests/data/dwarf3.o 3
+#   python3 tests/data/mkelf.py tests/data/dwarf5.o 5
+#   python3 tests/data/mkelf.py tests/data/exec_norelocs.o 3 exec
+#
+# A m68k relocatable object with two functions in .text, .data, .data_chip, .data.fastpath (which must not end up
+# in fast memory) and .bss_fast, relocations between them and a .debug_line unit of the given version. DWARF 5 units
+# take their directory and file names from .debug_line_str through relocations, like GCC 11 and later writes them.
+# With exec the same sections are linked into an executable without --emit-relocs, so there are no .rela sections.
+
+import struct
+import sys
+
+R_68K_32 = 1
+R_68K_PC16 = 5
+
+DW_LNCT_path = 1
+DW_LNCT_directory_index = 2
+DW_LNCT_MD5 = 5
+DW_FORM_data16 = 0x1e
+DW_FORM_udata = 0x0f
+DW_FORM_line_strp = 0x1f
+
+FUNCTION_COUNT = 2
+FUNCTION_SIZE = 26
+
+
+def u16(value):
+    return struct.pack('>H', value & 0xffff)
+
+
+def u32(value):
+    return struct.pack('>I', value & 0xffffffff)
+
+
+def uleb(value):
+    out = b''
+    while True:
+        byte = value & 0x7f
+        value >>= 7
+        if not value:
+            return out + bytes([byte])
+        out += bytes([byte | 0x80])
+
+
+def sleb(value):
+    out = b''
+    while True:
+        byte = value & 0x7f
+        value >>= 7
+        if (value == 0 and not byte & 0x40) or (value == -1 and byte & 0x40):
+            return out + bytes([byte])
+        out += bytes([byte | 0x80])
+
+
+class StringTable:
+    def __init__(self):
+        self.data = b'\0'
+
+    def add(self, text):
+        offset = len(self.data)
+        self.data += text.encode() + b'\0'
+        return offset
+
+
+def rela(offset, symbol, kind, addend):
+    return u32(offset) + u32((symbol << 8) | kind) + u32(addend)
+
+
+def build(version, executable):
+    names = ['.text', '.data', '.data_chip', '.data.fastpath', '.bss_fast', '.rela.text', '.rela.data', '.debug_line',
+             '.rela.debug_line']
+    if version >= 5:
+        names.append('.debug_line_str')
+    names += ['.symtab', '.strtab', '.shstrtab']
+    if executable:
+        names = [name for name in names if not name.startswith('.rela')]
+    index = {name: i + 1 for i, name in enumerate(names)}
+
+    # symbols: null, section symbols, locals, then globals
+
+    strtab = StringTable()
+    symbols = [(0, 0, 0, 0, 0)]
+    section_symbol = {}
+
+    for name in ('.text', '.data', '.data_chip', '.data.fastpath', '.bss_fast', '.debug_line_str'):
+        if name in index:
+            section_symbol[name] = len(symbols)
+            symbols.append((0, 0, 0, 3, index[name]))
+
+    symbols.append((strtab.add('main.c'), 0, 0, 4, 0xfff1))
+    symbols.append((strtab.add('.L1'), 8, 0, 0, index['.text']))
+    first_global = len(symbols)
+
+    func0 = len(symbols)
+    for i in range(FUNCTION_COUNT):
+        symbols.append((strtab.add('_func%d' % i), i * FUNCTION_SIZE, FUNCTION_SIZE, 0x12, index['.text']))
+
+    chipdata = len(symbols)
+    symbols.append((strtab.add('_chipdata'), 0, 4, 0x11, index['.data_chip']))
+    symbols.append((strtab.add('_data'), 0, 16, 0x11, index['.data']))
+    symbols.append((strtab.add('_fastpath'), 0, 4, 0x11, index['.data.fastpath']))
+    symbols.append((strtab.add('_buffer'), 0, 64, 0x11, index['.bss_fast']))
+    symbols.append((strtab.add('_printf'), 0, 0, 0x10, 0))
+    symbols.append((strtab.add('_absval'), 0x1234, 0, 0x10, 0xfff1))
+
+    symtab = b''.join(u32(name) + u32(value) + u32(size) + bytes([info, 0]) + u16(shndx)
+                      for (name, value, size, info, shndx) in symbols)
+
+    # move.l #_data+4*i,a0 / jsr _func0 / bra.w <start> / lea _chipdata,a0 / nop / rts
+
+    text = b''
+    rela_text = b''
+    rows = []
+
+    for i in range(FUNCTION_COUNT):
+        start = len(text)
+        text += bytes.fromhex('207c') + u32(0) + bytes.fromhex('4eb9') + u32(0) + bytes.fromhex('6000') + u16(0)
+        text += bytes.fromhex('41f9') + u32(0) + bytes.fromhex('4e714e75')
+
+        rela_text += rela(start + 2, section_symbol['.data'], R_68K_32, 4 * i)
+        rela_text += rela(start + 8, func0, R_68K_32, 0)
+        rela_text += rela(start + 14, section_symbol['.text'], R_68K_PC16, start)
+        rela_text += rela(start + 18, chipdata, R_68K_32, 0)
+
+        # address, line, file (1 is main.c, 2 is util.h in both versions)
+
+        rows += [(start, 10 + i * 3, 1 + i), (start + 6, 11 + i * 3, 1 + i), (start + 12, 12 + i * 3, 1 + i)]
+
+    data = u32(0x11111111) + u32(0) + u32(0x22222222) + u32(0x33333333)
+    rela_data = rela(4, section_symbol['.bss_fast'], R_68K_32, 8)
+
+    # .debug_line, offsets of string references are relative to the start of the unit until it's assembled
+
+    line_base, line_range, opcode_base = -5, 14, 13
+    line_strings = StringTable()
+    string_relocs = []
+
+    header = bytes([2])
+    if version >= 4:
+        header += bytes([1])
+    header += bytes([1, line_base & 0xff, line_range, opcode_base]) + bytes([0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1])
+
+    if version >= 5:
+        def line_strp(text):
+            string_relocs.append(len(header))
+            return u32(line_strings.add(text))
+
+        header += bytes([1]) + uleb(DW_LNCT_path) + uleb(DW_FORM_line_strp)
+        header += uleb(3)
+        for directory in ('/home/build', 'src', '/abs/inc'):
+            header += line_strp(directory)
+
+        header += bytes([3])
+        header += uleb(DW_LNCT_path) + uleb(DW_FORM_line_strp)
+        header += uleb(DW_LNCT_directory_index) + uleb(DW_FORM_udata)
+        header += uleb(DW_LNCT_MD5) + uleb(DW_FORM_data16)
+        header += uleb(3)
+        for name, directory in (('main.c', 1), ('main.c', 1), ('util.h', 2)):
+            header += line_strp(name) + uleb(directory) + bytes(range(16))
+    else:
+        header += b'src\0/abs/inc\0\0'
+        header += b'main.c\0' + uleb(1) + uleb(0) + uleb(0)
+        header += b'util.h\0' + uleb(2) + uleb(0) + uleb(0)
+        header += b'\0'
+
+    program = b'\0' + uleb(5) + bytes([2])
+    address_operand = len(program)
+    program += u32(0)
+
+    address, line, file = 0, 1, 1
+
+    for (row_address, row_line, row_file) in rows:
+        if row_file != file:
+            program += bytes([4]) + uleb(row_file)
+            file = row_file
+
+        advance = (row_address - address) // 2
+        special = advance * line_range + (row_line - line - line_base) + opcode_base
+
+        if line_base <= row_line - line < line_base + line_range and special <= 255:
+            program += bytes([special])
+        else:
+            program += bytes([2]) + uleb(advance) + bytes([3]) + sleb(row_line - line) + bytes([1])
+
+        address, line = row_address, row_line
+
+    program += bytes([2]) + uleb(2) + b'\0' + uleb(1) + bytes([1])
+
+    prefix = u16(version) + (bytes([4, 0]) if version >= 5 else b'')
+    header_start = 4 + len(prefix) + 4
+    unit = prefix + u32(len(header)) + header + program
+    debug_line = u32(len(unit)) + unit
+
+    rela_debug_line = rela(header_start + len(header) + address_operand, section_symbol['.text'], R_68K_32, 0)
+
+    for offset in string_relocs:
+        rela_debug_line += rela(header_start + offset, section_symbol['.debug_line_str'], R_68K_32,
+                                struct.unpack('>I', header[offset:offset + 4])[0])
+
+    # zero the stored offsets so only the relocations can get them right, like in a RELA object
+
+    if version >= 5:
+        patched = bytearray(debug_line)
+        for offset in string_relocs:
+            patched[header_start + offset:header_start + offset + 4] = u32(0)
+        debug_line = bytes(patched)
+
+    # sections
+
+    shstrtab = StringTable()
+    shstrtab_names = {name: shstrtab.add(name) for name in names}
+    contents = {
+        '.text': (1, 6, text, 0, 0, 0),
+        '.data': (1, 3, data, 0, 0, 0),
+        '.data_chip': (1, 3, u32(0xdeadbeef), 0, 0, 0),
+        '.data.fastpath': (1, 3, u32(0xfa57fa57), 0, 0, 0),
+        '.bss_fast': (8, 3, b'', 0, 0, 0),
+        '.rela.text': (4, 0x40, rela_text, index['.symtab'], index['.text'], 12),
+        '.rela.data': (4, 0x40, rela_data, index['.symtab'], index['.data'], 12),
+        '.debug_line': (1, 0, debug_line, 0, 0, 0),
+        '.rela.debug_line': (4, 0x40, rela_debug_line, index['.symtab'], index['.debug_line'], 12),
+        '.debug_line_str': (1, 0x30, line_strings.data, 0, 0, 1),
+        '.symtab': (2, 0, symtab, index['.strtab'], first_global, 16),
+        '.strtab': (3, 0, strtab.data, 0, 0, 0),
+        '.shstrtab': (3, 0, shstrtab.data, 0, 0, 0),
+    }
+
+    body = b''
+    headers = u32(0) * 10
+    address = 0
+
+    for name in names:
+        kind, flags, content, link, info, entsize = contents[name]
+        offset = 52 + len(body)
+        size = 64 if name == '.bss_fast' else len(content)
+        body += content + b'\0' * (-len(content) % 4)
+        addr = address if executable and flags & 2 else 0
+        address += size if addr else 0
+        headers += b''.join(u32(v) for v in (shstrtab_names[name], kind, flags, addr, offset, size, link, info, 4,
+                                              entsize))
+
+    ehdr = b'\x7fELF' + bytes([1, 2, 1, 0]) + b'\0' * 8
+    ehdr += u16(2 if executable else 1) + u16(4) + u32(1) + u32(0) + u32(0) + u32(52 + len(body)) + u32(0)
+    ehdr += u16(52) + u16(0) + u16(0) + u16(40) + u16(len(names) + 1) + u16(index['.shstrtab'])
+
+    return ehdr + body + headers
+
+
+if __name__ == '__main__':
+    with open(sys.argv[1], 'wb') as f:
+        f.write(build(int(sys.argv[2]), sys.argv[3:] == ['exec']))
@@ -0,0 +1,115 @@
+#include "test.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int g_testFailures = 0;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int test_write_file(const char* filename, const void* data, size_t size)
+{
+	FILE* f = fopen(filename, "wb");
+
+	if (!f)
+		return 0;
+
+	const size_t written = fwrite(data, 1, size, f);
+
+	fclose(f);
+
+	return written == size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void reserve(TestHunk* hunk, uint32_t size)
+{
+	if (hunk->size + size <= hunk->capacity)
+		return;
+
+	hunk->capacity = (hunk->size + size) * 2;
+	hunk->data = realloc(hunk->data, hunk->capacity);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_hunk_u32(TestHunk* hunk, uint32_t value)
+{
+	reserve(hunk, 4);
+	hunk->data[hunk->size + 0] = (uint8_t)(value >> 24);
+	hunk->data[hunk->size + 1] = (uint8_t)(value >> 16);
+	hunk->data[hunk->size + 2] = (uint8_t)(value >> 8);
+	hunk->data[hunk->size + 3] = (uint8_t)value;
+	hunk->size += 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_hunk_string(TestHunk* hunk, const char* text)
+{
+	const uint32_t length = (uint32_t)strlen(text);
+	const uint32_t longs = (length + 3) / 4;
+
+	test_hunk_u32(hunk, longs);
+
+	reserve(hunk, longs * 4);
+	memset(hunk->data + hunk->size, 0, longs * 4);
+	memcpy(hunk->data + hunk->size, text, length);
+	hunk->size += longs * 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int test_hunk_save(const TestHunk* hunk, const char* filename)
+{
+	return test_write_file(filename, hunk->data, hunk->size);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_hunk_free(TestHunk* hunk)
+{
+	free(hunk->data);
+	hunk->data = 0;
+	hunk->size = 0;
+	hunk->capacity = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct TestCase
+{
+	const char* name;
+	void (*run)(void);
+
+} TestCase;
+
+static const TestCase s_tests[] =
+{
+	{ "compact", test_compact },
+	{ "diff", test_diff },
+	{ "elf", test_elf },
+	{ "index", test_index },
+	{ "insn", test_insn },
+	{ "parser", test_parser },
+	{ "stabs", test_stabs },
+	{ "xref", test_xref },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(void)
+{
+	for (size_t i = 0; i < sizeof(s_tests) / sizeof(s_tests[0]); ++i)
+	{
+		const int failures = g_testFailures;
+
+		s_tests[i].run();
+
+		printf("%-10s %s\n", s_tests[i].name, g_testFailures == failures ? "ok" : "FAILED");
+	}
+
+	return g_testFailures ? 1 : 0;
+}
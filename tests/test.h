@@ -0,0 +1,59 @@
+#ifndef AHP_TEST_
+#define AHP_TEST_
+
+#include "../amiga_hunk_parser.h"
+#include <stdio.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Minimal test harness, a failed check is reported and counted but the test keeps going. Tests are run from the root
+// of the repository (make test) so fixtures are found in tests/data.
+
+extern int g_testFailures;
+
+#define TEST_CHECK(cond) \
+	do \
+	{ \
+		if (!(cond)) \
+		{ \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			g_testFailures++; \
+		} \
+	} while (0)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Scratch file for tests that need to go through ahp_parse_file
+#define TEST_TEMP_FILE "tests/ahp_test.tmp"
+
+// Writes size bytes to filename, returns 0 on failure
+int test_write_file(const char* filename, const void* data, size_t size);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Builds hunk files a longword at a time, for files the writer can't (or won't) produce
+
+typedef struct TestHunk
+{
+	uint8_t* data;
+	uint32_t size;
+	uint32_t capacity;
+
+} TestHunk;
+
+void test_hunk_u32(TestHunk* hunk, uint32_t value);
+
+// Length in longwords followed by the string padded with zeros
+void test_hunk_string(TestHunk* hunk, const char* text);
+
+int test_hunk_save(const TestHunk* hunk, const char* filename);
+void test_hunk_free(TestHunk* hunk);
+
+void test_compact(void);
+void test_diff(void);
+void test_elf(void);
+void test_index(void);
+void test_insn(void);
+void test_parser(void);
+void test_stabs(void);
+void test_xref(void);
+
+#endif
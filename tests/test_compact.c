@@ -0,0 +1,134 @@
+#include "test.h"
+#include "../amiga_hunk_compact.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One CODE section with two symbols, lines from two files and a stabs block, the way the parser leaves them
+
+static AHPSymbolInfo s_symbols[] =
+{
+	{ "_start", 0 },
+	{ "_main", 0x20 },
+};
+
+static uint32_t s_mainAddresses[] = { 0, 8, 8, 0x20 };
+static int s_mainLines[] = { 10, 11, 12, 20 };
+static uint32_t s_utilAddresses[] = { 0, 4 };
+static int s_utilLines[] = { 5, 6 };
+
+static AHPLineInfo s_lines[] =
+{
+	{ "main.c", 4, 0, s_mainAddresses, s_mainLines },
+	{ "util.h", 2, 0x10, s_utilAddresses, s_utilLines },
+};
+
+static AHPDebugBlock s_blocks[] =
+{
+	{ 0x100, 0x40 },
+};
+
+static AHPReloc s_relocs[] =
+{
+	{ 2, 0, AHPRelocKind_Absolute, 4 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static AHPCompact* createCompact(void)
+{
+	AHPSection section;
+	AHPInfo info;
+
+	memset(&section, 0, sizeof(section));
+	memset(&info, 0, sizeof(info));
+
+	section.type = AHPSectionType_Code;
+	section.memSize = section.dataSize = 0x40;
+	section.symbols = s_symbols;
+	section.symbolCount = 2;
+	section.debugLines = s_lines;
+	section.debugLineCount = 2;
+	section.debugBlocks = s_blocks;
+	section.debugBlockCount = 1;
+	section.relocs = s_relocs;
+	section.relocCount = 1;
+
+	info.sections = &section;
+	info.sectionCount = 1;
+
+	return ahp_compact_create(&info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testLookups(void)
+{
+	const char* filename = 0;
+	int line = 0;
+
+	AHPCompact* compact = createCompact();
+	TEST_CHECK(compact && ahp_compact_validate(compact, compact->size));
+
+	if (!compact)
+		return;
+
+	const AHPCompactSection* section = ahp_compact_section(compact, 0);
+
+	TEST_CHECK(section->debugBlockCount == 1);
+	TEST_CHECK(ahp_compact_debug_blocks(compact, section)[0].start == 0x100);
+	TEST_CHECK(ahp_compact_debug_blocks(compact, section)[0].size == 0x40);
+
+	TEST_CHECK(ahp_compact_find_symbol(compact, section, 0x1f)->address == 0);
+	TEST_CHECK(ahp_compact_find_symbol(compact, section, 0x20)->address == 0x20);
+
+	// the last of two lines at the same address, and the closest line of both files
+
+	TEST_CHECK(ahp_compact_find_line(compact, section, 0x0a, &filename, &line) && line == 12);
+	TEST_CHECK(ahp_compact_find_line(compact, section, 0x14, &filename, &line) && line == 6);
+	TEST_CHECK(!strcmp(filename, "util.h"));
+	TEST_CHECK(ahp_compact_find_line(compact, section, 0x20, &filename, &line) && line == 20);
+
+	free(compact);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Blobs that come from somewhere else with the tables out of order have to be rejected, the binary searches would
+// give wrong answers
+
+static void testUnsortedBlob(void)
+{
+	AHPCompact* compact = createCompact();
+
+	if (!compact)
+		return;
+
+	const AHPCompactSection* section = ahp_compact_section(compact, 0);
+	AHPCompactSymbol* symbols = (AHPCompactSymbol*)ahp_compact_symbols(compact, section);
+	AHPCompactLine* lines = (AHPCompactLine*)ahp_compact_lines(compact, ahp_compact_line_files(compact, section));
+
+	symbols[0].address = 0x30;
+	TEST_CHECK(!ahp_compact_validate(compact, compact->size));
+	symbols[0].address = 0;
+
+	lines[1].address = 0x30;
+	TEST_CHECK(!ahp_compact_validate(compact, compact->size));
+	lines[1].address = 8;
+
+	TEST_CHECK(ahp_compact_validate(compact, compact->size));
+
+	// a debug block table that runs past the end
+
+	((AHPCompactSection*)section)->debugBlockCount = compact->size;
+	TEST_CHECK(!ahp_compact_validate(compact, compact->size));
+
+	free(compact);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_compact(void)
+{
+	testLookups();
+	testUnsortedBlob();
+}
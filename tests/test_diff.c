@@ -0,0 +1,163 @@
+#include "test.h"
+#include "../amiga_hunk_diff.h"
+#include "../doshunks.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum
+{
+	CodeLongs = 48,
+	InsertAt = 16,		// longword the inserted nops go in front of
+	PointerLong = 40,	// longword holding a pointer into the section
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// One CODE section of distinct longwords with insertLongs nops at InsertAt and pointer at PointerLong, which gets a
+// relocation if relocated is set
+
+static AHPInfo* parseCode(uint32_t insertLongs, uint32_t pointer, int relocated)
+{
+	const uint32_t codeLongs = CodeLongs + insertLongs;
+	TestHunk hunk = { 0 };
+
+	test_hunk_u32(&hunk, HUNK_HEADER);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, 1);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, codeLongs);
+
+	test_hunk_u32(&hunk, HUNK_CODE);
+	test_hunk_u32(&hunk, codeLongs);
+
+	for (uint32_t i = 0; i < CodeLongs; ++i)
+	{
+		if (i == InsertAt)
+		{
+			for (uint32_t j = 0; j < insertLongs; ++j)
+				test_hunk_u32(&hunk, 0x4e714e71);
+		}
+
+		test_hunk_u32(&hunk, i == PointerLong ? pointer : i * 0x9e3779b9u);
+	}
+
+	if (relocated)
+	{
+		test_hunk_u32(&hunk, HUNK_RELOC32);
+		test_hunk_u32(&hunk, 1);
+		test_hunk_u32(&hunk, 0);
+		test_hunk_u32(&hunk, (PointerLong + insertLongs) * 4);
+		test_hunk_u32(&hunk, 0);
+	}
+
+	test_hunk_u32(&hunk, HUNK_END);
+
+	TEST_CHECK(test_hunk_save(&hunk, TEST_TEMP_FILE));
+	test_hunk_free(&hunk);
+
+	AHPInfo* info = ahp_parse_file(TEST_TEMP_FILE);
+	remove(TEST_TEMP_FILE);
+
+	TEST_CHECK(info != 0);
+
+	return info;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Diff between two versions of the code, 0 if one of them failed to parse
+
+static AHPDiff* diffCode(uint32_t insertLongsB, uint32_t pointerA, uint32_t pointerB, int relocated)
+{
+	AHPInfo* a = parseCode(0, pointerA, relocated);
+	AHPInfo* b = parseCode(insertLongsB, pointerB, relocated);
+	AHPDiff* diff = a && b ? ahp_diff(a, b) : 0;
+
+	if (a)
+		ahp_free(a);
+
+	if (b)
+		ahp_free(b);
+
+	return diff;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testUnchanged(void)
+{
+	AHPDiff* diff = diffCode(0, 0x100, 0x100, 1);
+
+	if (!diff)
+		return;
+
+	TEST_CHECK(diff->regionCount == 0);
+
+	ahp_diff_free(diff);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Four nops inserted move everything after them, including the relocation and the address it points to. Only the
+// nops may show up.
+
+static void testInserted(void)
+{
+	AHPDiff* diff = diffCode(4, 0x100, 0x110, 1);
+
+	if (!diff)
+		return;
+
+	const AHPDiffRegion* region = diff->regions;
+
+	TEST_CHECK(diff->regionCount == 1);
+
+	if (diff->regionCount == 1)
+	{
+		TEST_CHECK(region->kind == AHPDiffKind_Inserted && region->sectionA == 0 && region->sectionB == 0);
+		TEST_CHECK(region->offsetA == InsertAt * 4 && region->sizeA == 0);
+		TEST_CHECK(region->offsetB == InsertAt * 4 && region->sizeB == 16);
+	}
+
+	ahp_diff_free(diff);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A relocated longword that only changed value compares equal, the same change without the relocation doesn't
+
+static void testRelocatedChange(void)
+{
+	AHPDiff* diff = diffCode(0, 0x100, 0x200, 1);
+
+	if (diff)
+	{
+		TEST_CHECK(diff->regionCount == 0);
+		ahp_diff_free(diff);
+	}
+
+	diff = diffCode(0, 0x100, 0x200, 0);
+
+	if (!diff)
+		return;
+
+	const AHPDiffRegion* region = diff->regions;
+
+	TEST_CHECK(diff->regionCount == 1);
+
+	if (diff->regionCount == 1)
+	{
+		TEST_CHECK(region->kind == AHPDiffKind_Changed);
+		TEST_CHECK(region->offsetA >= PointerLong * 4 && region->offsetA + region->sizeA <= PointerLong * 4 + 4);
+	}
+
+	ahp_diff_free(diff);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_diff(void)
+{
+	testUnchanged();
+	testInserted();
+	testRelocatedChange();
+}
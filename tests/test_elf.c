@@ -0,0 +1,196 @@
+#include "test.h"
+#include "../amiga_hunk_elf.h"
+#include "../amiga_hunk_writer.h"
+#include "../endian.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The fixtures are written by tests/data/mkelf.py, the same object with a DWARF 3 and a DWARF 5 line table
+
+static const char* s_fixtures[] =
+{
+	"tests/data/dwarf3.o",
+	"tests/data/dwarf5.o",
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int hasReloc(const AHPSection* section, uint32_t offset, uint16_t target)
+{
+	for (int i = 0; i < section->relocCount; ++i)
+	{
+		const AHPReloc* reloc = &section->relocs[i];
+
+		if (reloc->offset == offset && reloc->target == target && reloc->kind == AHPRelocKind_Absolute &&
+			reloc->width == 4)
+			return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int hasLine(const AHPSection* section, uint32_t offset, const char* filename, int line)
+{
+	const char* foundFile = 0;
+	int foundLine = 0;
+
+	return ahp_find_line(section, offset, &foundFile, &foundLine) && foundLine == line &&
+		   !strcmp(foundFile, filename);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// What the converter has to make of the fixture
+
+static void checkConverted(const AHPInfo* info)
+{
+	const uint8_t* data = (const uint8_t*)info->fileData;
+
+	TEST_CHECK(info->sectionCount == 5);
+
+	if (info->sectionCount != 5)
+		return;
+
+	const AHPSection* code = &info->sections[0];
+	const uint8_t* text = data + code->dataStart;
+
+	TEST_CHECK(code->type == AHPSectionType_Code && code->target == AHPSectionTarget_Any && code->memSize == 52);
+	TEST_CHECK(info->sections[1].type == AHPSectionType_Data && info->sections[1].target == AHPSectionTarget_Any);
+	TEST_CHECK(info->sections[2].type == AHPSectionType_Data && info->sections[2].target == AHPSectionTarget_Chip);
+	TEST_CHECK(info->sections[3].type == AHPSectionType_Data && info->sections[3].target == AHPSectionTarget_Any);
+	TEST_CHECK(info->sections[4].type == AHPSectionType_Bss && info->sections[4].target == AHPSectionTarget_Fast);
+	TEST_CHECK(info->sections[4].memSize == 64);
+
+	// move.l #_data+4*i,a0 / jsr _func0 / bra.w <function> / lea _chipdata,a0 in both functions
+
+	TEST_CHECK(code->relocCount == 6);
+
+	for (uint32_t start = 0; start < 52; start += 26)
+	{
+		TEST_CHECK(hasReloc(code, start + 2, 1) && hasReloc(code, start + 8, 0) && hasReloc(code, start + 18, 2));
+		TEST_CHECK(ahp_load_be32(text + start + 2) == start / 26 * 4);
+		TEST_CHECK(ahp_load_be16(text + start + 14) == 0xfff2);
+	}
+
+	TEST_CHECK(info->sections[1].relocCount == 1 && hasReloc(&info->sections[1], 4, 4));
+	TEST_CHECK(ahp_load_be32(data + info->sections[1].dataStart + 4) == 8);
+
+	// section, file and .L symbols are left out
+
+	TEST_CHECK(code->symbolCount == 2);
+	TEST_CHECK(!strcmp(code->symbols[0].name, "_func0") && code->symbols[0].address == 0);
+	TEST_CHECK(!strcmp(code->symbols[1].name, "_func1") && code->symbols[1].address == 26);
+	TEST_CHECK(info->sections[3].symbolCount == 1 && !strcmp(info->sections[3].symbols[0].name, "_fastpath"));
+
+	TEST_CHECK(code->debugLineCount == 2);
+	TEST_CHECK(hasLine(code, 0, "src/main.c", 10));
+	TEST_CHECK(hasLine(code, 14, "src/main.c", 12));
+	TEST_CHECK(hasLine(code, 26, "/abs/inc/util.h", 13));
+	TEST_CHECK(hasLine(code, 0x20, "/abs/inc/util.h", 14));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writing the converted info and parsing it again has to give back the same sections, relocations, symbols and lines
+
+static void compareInfo(const AHPInfo* a, const AHPInfo* b)
+{
+	TEST_CHECK(a->sectionCount == b->sectionCount);
+
+	for (int s = 0; s < a->sectionCount && s < b->sectionCount; ++s)
+	{
+		const AHPSection* sa = &a->sections[s];
+		const AHPSection* sb = &b->sections[s];
+
+		TEST_CHECK(sa->type == sb->type && sa->target == sb->target && sa->memSize == sb->memSize);
+
+		// the parser sets dataSize to the size of BSS hunks too, they have no data to compare
+
+		if (sa->type != AHPSectionType_Bss)
+		{
+			TEST_CHECK(sa->dataSize == sb->dataSize);
+			TEST_CHECK(!memcmp((const uint8_t*)a->fileData + sa->dataStart,
+							   (const uint8_t*)b->fileData + sb->dataStart,
+							   sa->dataSize < sb->dataSize ? sa->dataSize : sb->dataSize));
+		}
+
+		TEST_CHECK(sa->relocCount == sb->relocCount);
+
+		for (int i = 0; i < sa->relocCount; ++i)
+			TEST_CHECK(hasReloc(sb, sa->relocs[i].offset, sa->relocs[i].target));
+
+		TEST_CHECK(sa->symbolCount == sb->symbolCount);
+
+		for (int i = 0; i < sa->symbolCount && i < sb->symbolCount; ++i)
+		{
+			TEST_CHECK(!strcmp(sa->symbols[i].name, sb->symbols[i].name));
+			TEST_CHECK(sa->symbols[i].address == sb->symbols[i].address);
+		}
+
+		TEST_CHECK(sa->debugLineCount == sb->debugLineCount);
+
+		for (int i = 0; i < sa->debugLineCount; ++i)
+		{
+			const AHPLineInfo* lines = &sa->debugLines[i];
+
+			for (int l = 0; l < lines->count; ++l)
+				TEST_CHECK(hasLine(sb, lines->baseOffset + lines->addresses[l], lines->filename, lines->lines[l]));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testRoundTrip(const char* fixture)
+{
+	AHPWriter writer;
+
+	AHPInfo* converted = ahp_elf_load(fixture);
+	TEST_CHECK(converted != 0);
+
+	if (!converted)
+		return;
+
+	checkConverted(converted);
+
+	ahp_writer_init(&writer, 0);
+	TEST_CHECK(ahp_write_info(&writer, converted));
+	TEST_CHECK(ahp_writer_save(&writer, TEST_TEMP_FILE));
+	ahp_writer_free(&writer);
+
+	AHPInfo* parsed = ahp_parse_file(TEST_TEMP_FILE);
+	remove(TEST_TEMP_FILE);
+
+	TEST_CHECK(parsed != 0);
+
+	if (parsed)
+	{
+		compareInfo(converted, parsed);
+		ahp_free(parsed);
+	}
+
+	ahp_free(converted);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The same sections linked into an executable without --emit-relocs can't be converted
+
+static void testExecWithoutRelocs(void)
+{
+	AHPInfo* info = ahp_elf_load("tests/data/exec_norelocs.o");
+	TEST_CHECK(info == 0);
+
+	if (info)
+		ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_elf(void)
+{
+	for (size_t i = 0; i < sizeof(s_fixtures) / sizeof(s_fixtures[0]); ++i)
+		testRoundTrip(s_fixtures[i]);
+
+	testExecWithoutRelocs();
+}
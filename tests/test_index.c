@@ -0,0 +1,300 @@
+#include "test.h"
+#include "../amiga_hunk_index.h"
+#include "../doshunks.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs "ahp_index scan" over a directory of generated executables, then checks the tables in the index and the
+// answers of the symbol and section queries. The binary is ./ahp_index (make test builds it), AHP_INDEX overrides it.
+//
+// Files by id (path order): a (CODE _main _init, DATA _table _main), b (CODE _main _exit), sub/c (same bytes as a).
+// notes.txt isn't a hunk file and is left out.
+
+#define INDEX_DIR "tests/ahp_index_test"
+#define INDEX_FILE "tests/ahp_index_test.idx"
+
+static const char* s_files[] =
+{
+	INDEX_DIR "/a",
+	INDEX_DIR "/b",
+	INDEX_DIR "/sub/c",
+	INDEX_DIR "/notes.txt",
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void putSymbols(TestHunk* hunk, const char* first, const char* second)
+{
+	test_hunk_u32(hunk, HUNK_SYMBOL);
+	test_hunk_string(hunk, first);
+	test_hunk_u32(hunk, 0);
+
+	if (second)
+	{
+		test_hunk_string(hunk, second);
+		test_hunk_u32(hunk, 8);
+	}
+
+	test_hunk_u32(hunk, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A CODE section of four longwords from seed with _main and symbol, and a DATA section with _table and another _main
+// if withData is set
+
+static int writeExecutable(const char* filename, uint32_t seed, const char* symbol, int withData)
+{
+	const uint32_t sectionCount = withData ? 2 : 1;
+	TestHunk hunk = { 0 };
+
+	test_hunk_u32(&hunk, HUNK_HEADER);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, sectionCount);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, sectionCount - 1);
+
+	for (uint32_t i = 0; i < sectionCount; ++i)
+		test_hunk_u32(&hunk, 4);
+
+	test_hunk_u32(&hunk, HUNK_CODE);
+	test_hunk_u32(&hunk, 4);
+
+	for (uint32_t i = 0; i < 4; ++i)
+		test_hunk_u32(&hunk, seed + i);
+
+	putSymbols(&hunk, "_main", symbol);
+	test_hunk_u32(&hunk, HUNK_END);
+
+	if (withData)
+	{
+		test_hunk_u32(&hunk, HUNK_DATA);
+		test_hunk_u32(&hunk, 4);
+
+		for (uint32_t i = 0; i < 4; ++i)
+			test_hunk_u32(&hunk, 0x11111111 * i);
+
+		putSymbols(&hunk, "_table", "_main");
+		test_hunk_u32(&hunk, HUNK_END);
+	}
+
+	const int result = test_hunk_save(&hunk, filename);
+	test_hunk_free(&hunk);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void removeFiles(void)
+{
+	for (size_t i = 0; i < sizeof(s_files) / sizeof(s_files[0]); ++i)
+		remove(s_files[i]);
+
+	rmdir(INDEX_DIR "/sub");
+	rmdir(INDEX_DIR);
+	remove(INDEX_FILE);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runs ahp_index with args, the output goes to output (cut off at size - 1), returns 0 if it didn't exit with 0
+
+static int runIndex(const char* args, char* output, size_t size)
+{
+	const char* binary = getenv("AHP_INDEX") ? getenv("AHP_INDEX") : "./ahp_index";
+	char command[512];
+	size_t length = 0, n;
+
+	snprintf(command, sizeof(command), "%s %s", binary, args);
+
+	FILE* f = popen(command, "r");
+
+	if (!f)
+		return 0;
+
+	while (length + 1 < size && (n = fread(output + length, 1, size - 1 - length, f)) > 0)
+		length += n;
+
+	output[length] = 0;
+
+	const int status = pclose(f);
+
+	return status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t* loadIndex(uint64_t* size)
+{
+	FILE* f = fopen(INDEX_FILE, "rb");
+	uint8_t* data = 0;
+	long length;
+
+	if (!f)
+		return 0;
+
+	if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+	{
+		data = (uint8_t*)malloc((size_t)length);
+
+		if (data && fread(data, 1, (size_t)length, f) != (size_t)length)
+		{
+			free(data);
+			data = 0;
+		}
+
+		*size = (uint64_t)length;
+	}
+
+	fclose(f);
+
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Posting list of name as a bit per file id, or ~0 if the name isn't in the symbol table
+
+static uint32_t postingMask(const uint8_t* data, const char* name)
+{
+	const AHPIndexHeader* header = (const AHPIndexHeader*)data;
+	const AHPIndexSymbol* symbols = (const AHPIndexSymbol*)(data + header->symbolsOffset);
+	const uint32_t* postings = (const uint32_t*)(data + header->postingsOffset);
+	const char* strings = (const char*)(data + header->stringsOffset);
+
+	for (uint32_t i = 0; i < header->symbolCount; ++i)
+	{
+		if (strcmp(strings + symbols[i].name, name) != 0)
+			continue;
+
+		uint32_t mask = 0;
+
+		for (uint32_t p = symbols[i].firstPosting; p < symbols[i].firstPosting + symbols[i].postingCount; ++p)
+			mask |= 1u << postings[p];
+
+		return mask;
+	}
+
+	return ~0u;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void checkTables(const uint8_t* data, uint64_t size, uint64_t hash)
+{
+	const AHPIndexHeader* header = (const AHPIndexHeader*)data;
+
+	TEST_CHECK(size >= sizeof(AHPIndexHeader) && header->magic == AHP_INDEX_MAGIC);
+	TEST_CHECK(header->version == AHP_INDEX_VERSION && header->stringsOffset + header->stringSize <= size);
+	TEST_CHECK(header->fileCount == 3 && header->sectionCount == 5 && header->symbolCount == 4);
+
+	if (header->magic != AHP_INDEX_MAGIC || header->stringsOffset + header->stringSize > size ||
+		header->fileCount != 3 || header->sectionCount != 5 || header->symbolCount != 4)
+		return;
+
+	const AHPIndexFile* files = (const AHPIndexFile*)(data + header->filesOffset);
+	const AHPIndexSymbol* symbols = (const AHPIndexSymbol*)(data + header->symbolsOffset);
+	const AHPIndexHash* hashes = (const AHPIndexHash*)(data + header->hashesOffset);
+	const char* strings = (const char*)(data + header->stringsOffset);
+
+	for (uint32_t i = 0; i < 3; ++i)
+		TEST_CHECK(!strcmp(strings + files[i].path, s_files[i]));
+
+	TEST_CHECK(files[1].firstSection == 2 && files[1].sectionCount == 1 && files[2].symbolCount == 4);
+
+	for (uint32_t i = 1; i < header->symbolCount; ++i)
+		TEST_CHECK(strcmp(strings + symbols[i - 1].name, strings + symbols[i].name) < 0);
+
+	// _main is in two sections of a but a file is only posted once per name
+
+	TEST_CHECK(postingMask(data, "_main") == 7);
+	TEST_CHECK(postingMask(data, "_init") == 5);
+	TEST_CHECK(postingMask(data, "_exit") == 2);
+	TEST_CHECK(postingMask(data, "_table") == 5);
+	TEST_CHECK(header->postingCount == 8);
+
+	// the hashes are sorted and the CODE section of a shows up for a and sub/c
+
+	uint32_t hashFiles = 0;
+
+	for (uint32_t i = 0; i < header->sectionCount; ++i)
+	{
+		TEST_CHECK(i == 0 || hashes[i - 1].hash <= hashes[i].hash);
+
+		if (hashes[i].hash == hash)
+			hashFiles |= 1u << hashes[i].file;
+	}
+
+	TEST_CHECK(hashFiles == 5);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void checkQueries(uint64_t hash)
+{
+	static const char initFiles[] = INDEX_DIR "/a\n" INDEX_DIR "/sub/c\n2 matches";
+	char output[4096];
+	char args[256];
+
+	TEST_CHECK(runIndex("symbol " INDEX_FILE " _ma*", output, sizeof(output)));
+	TEST_CHECK(strstr(output, "_main  " INDEX_DIR "/a\n") && strstr(output, "_main  " INDEX_DIR "/b\n"));
+	TEST_CHECK(strstr(output, "_main  " INDEX_DIR "/sub/c\n") && strstr(output, "\n3 matches"));
+
+	TEST_CHECK(runIndex("symbol " INDEX_FILE " _init", output, sizeof(output)));
+	TEST_CHECK(!strncmp(output, initFiles, sizeof(initFiles) - 1));
+
+	// a name that is a prefix of others only matches itself without the *
+
+	TEST_CHECK(runIndex("symbol " INDEX_FILE " _ma", output, sizeof(output)));
+	TEST_CHECK(!strncmp(output, "0 matches", 9));
+
+	snprintf(args, sizeof(args), "section " INDEX_FILE " %llx", (unsigned long long)hash);
+
+	TEST_CHECK(runIndex(args, output, sizeof(output)));
+	TEST_CHECK(strstr(output, "  " INDEX_DIR "/a  section 0 ") && strstr(output, "  " INDEX_DIR "/sub/c  section 0 "));
+	TEST_CHECK(strstr(output, "\n2 matches"));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_index(void)
+{
+	char output[4096];
+	uint64_t size = 0;
+
+	removeFiles();
+
+	TEST_CHECK(mkdir(INDEX_DIR, 0700) == 0 && mkdir(INDEX_DIR "/sub", 0700) == 0);
+	TEST_CHECK(writeExecutable(s_files[0], 0x4e710000, "_init", 1));
+	TEST_CHECK(writeExecutable(s_files[1], 0x70000000, "_exit", 0));
+	TEST_CHECK(writeExecutable(s_files[2], 0x4e710000, "_init", 1));
+	TEST_CHECK(test_write_file(s_files[3], "not a hunk file\n", 16));
+
+	AHPInfo* info = ahp_parse_file(s_files[0]);
+	TEST_CHECK(info != 0);
+
+	if (!info)
+	{
+		removeFiles();
+		return;
+	}
+
+	const uint64_t hash = ahp_section_hash(info, &info->sections[0]);
+	ahp_free(info);
+
+	TEST_CHECK(runIndex("scan -j 2 " INDEX_DIR " " INDEX_FILE, output, sizeof(output)));
+
+	uint8_t* data = loadIndex(&size);
+	TEST_CHECK(data != 0);
+
+	if (data)
+	{
+		checkTables(data, size, hash);
+		checkQueries(hash);
+		free(data);
+	}
+
+	removeFiles();
+}
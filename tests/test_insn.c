@@ -0,0 +1,216 @@
+#include "test.h"
+#include "../amiga_hunk_insn.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Known encodings with their lengths on 68000 and 68020, 0 is an invalid instruction
+
+typedef struct Encoding
+{
+	const char* name;
+	uint16_t words[5];
+	int size;
+	int length68000;
+	int length68020;
+
+} Encoding;
+
+static const Encoding s_encodings[] =
+{
+	{ "nop", { 0x4e71 }, 2, 2, 2 },
+	{ "rts", { 0x4e75 }, 2, 2, 2 },
+	{ "movea.l #imm,a0", { 0x207c, 0x1234, 0x5678 }, 6, 6, 6 },
+	{ "move.l abs.l,d0", { 0x2039, 0x1234, 0x5678 }, 6, 6, 6 },
+	{ "move.l d0,abs.l", { 0x23c0, 0x1234, 0x5678 }, 6, 6, 6 },
+	{ "move.w #imm,abs.l", { 0x33fc, 0x1234, 0x1234, 0x5678 }, 8, 8, 8 },
+	{ "move.l d0,(a0)", { 0x2080 }, 2, 2, 2 },
+	{ "move.w d16(pc),d0", { 0x303a, 0x0010 }, 4, 4, 4 },
+	{ "movea.w d0,a1", { 0x3240 }, 2, 2, 2 },
+	{ "move.l (a0,d0.w),d1", { 0x2230, 0x0000 }, 4, 4, 4 },
+	{ "move.l (bd.l,a0,d0.w),d1", { 0x2230, 0x0130, 0x1234, 0x5678 }, 8, 4, 8 },
+	{ "jsr abs.l", { 0x4eb9, 0x1234, 0x5678 }, 6, 6, 6 },
+	{ "lea d16(pc),a0", { 0x41fa, 0x0010 }, 4, 4, 4 },
+	{ "bra.s", { 0x6010 }, 2, 2, 2 },
+	{ "bra.w", { 0x6000, 0x0010 }, 4, 4, 4 },
+	{ "bra.l", { 0x60ff, 0x0000, 0x0010 }, 6, 2, 6 },
+	{ "cmpi.l #imm,d0", { 0x0c80, 0x0000, 0x0001 }, 6, 6, 6 },
+	{ "movem.l regs,-(sp)", { 0x48e7, 0x3f3e }, 4, 4, 4 },
+	{ "movem.l (sp)+,regs", { 0x4cdf, 0x7cfc }, 4, 4, 4 },
+	{ "mulu.l d0,d1", { 0x4c00, 0x1000 }, 4, 0, 4 },
+	{ "fmove.x fp0,fp1", { 0xf200, 0x0080 }, 4, 0, 4 },
+	{ "moves.l (a0),d0", { 0x0e90, 0x0800 }, 4, 0, 4 },
+	{ "moves.l d0 (no memory operand)", { 0x0e80, 0x0800 }, 4, 0, 0 },
+	{ "rtd #imm", { 0x4e74, 0x0004 }, 4, 0, 4 },
+	{ "movec vbr,d0", { 0x4e7a, 0x0801 }, 4, 0, 4 },
+	{ "movec d0,vbr", { 0x4e7b, 0x0801 }, 4, 0, 4 },
+	{ "stop #imm", { 0x4e72, 0x2700 }, 4, 4, 4 },
+	{ "move.w d0,d16(pc)", { 0x35c0, 0x0010 }, 4, 0, 0 },
+	{ "move.l d0,#imm", { 0x29c0, 0x0000, 0x0000 }, 6, 0, 0 },
+	{ "move.b d0,a1", { 0x1240 }, 2, 0, 0 },
+	{ "line a", { 0xa000 }, 2, 0, 0 },
+	{ "jsr abs.l (truncated)", { 0x4eb9, 0x1234 }, 4, 0, 0 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// out has to hold wordCount * 2 bytes
+
+static void toBytes(uint8_t* out, const uint16_t* words, size_t wordCount)
+{
+	for (size_t i = 0; i < wordCount; ++i)
+	{
+		out[i * 2 + 0] = (uint8_t)(words[i] >> 8);
+		out[i * 2 + 1] = (uint8_t)words[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testLengths(void)
+{
+	for (size_t i = 0; i < sizeof(s_encodings) / sizeof(s_encodings[0]); ++i)
+	{
+		const Encoding* encoding = &s_encodings[i];
+		uint8_t code[sizeof(encoding->words)];
+
+		toBytes(code, encoding->words, sizeof(encoding->words) / sizeof(encoding->words[0]));
+
+		const int length68000 = ahp_insn_length(code, encoding->size, 0, AHPCpu_68000);
+		const int length68020 = ahp_insn_length(code, encoding->size, 0, AHPCpu_68020);
+
+		if (length68000 != encoding->length68000 || length68020 != encoding->length68020)
+		{
+			printf("%s: got %d/%d, expected %d/%d\n", encoding->name, length68000, length68020,
+				   encoding->length68000, encoding->length68020);
+		}
+
+		TEST_CHECK(length68000 == encoding->length68000);
+		TEST_CHECK(length68020 == encoding->length68020);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// nop, jsr abs.l (relocated), rts, a relocated pointer in the code, then a function with a symbol
+
+static const uint16_t s_code[] =
+{
+	0x4e71,
+	0x4eb9, 0x0000, 0x000e,
+	0x4e75,
+	0x0000, 0x0010,
+	0x7001,
+	0x4e75,
+};
+
+static AHPReloc s_codeRelocs[] =
+{
+	{ 4, 0, AHPRelocKind_Absolute, 4 },
+	{ 10, 0, AHPRelocKind_Absolute, 4 },
+};
+
+static AHPSymbolInfo s_codeSymbols[] =
+{
+	{ "_start", 0 },
+	{ "_func", 14 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void initCode(AHPInfo* info, AHPSection* sections, int sectionCount, uint8_t* data)
+{
+	memset(info, 0, sizeof(AHPInfo));
+	memset(sections, 0, sectionCount * sizeof(AHPSection));
+
+	toBytes(data, s_code, sizeof(s_code) / sizeof(s_code[0]));
+
+	for (int i = 0; i < sectionCount; ++i)
+	{
+		AHPSection* section = &sections[i];
+
+		// every other section is DATA, which doesn't get an index
+
+		section->type = (i & 1) ? AHPSectionType_Data : AHPSectionType_Code;
+		section->memSize = section->dataSize = sizeof(s_code);
+		section->relocs = s_codeRelocs;
+		section->relocCount = 2;
+		section->symbols = s_codeSymbols;
+		section->symbolCount = 2;
+	}
+
+	info->sections = sections;
+	info->sectionCount = sectionCount;
+	info->fileData = data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testIndex(void)
+{
+	static const uint32_t expectedStarts[] = { 0, 2, 8, 10, 14, 16 };
+	uint8_t data[sizeof(s_code)];
+	AHPSection section;
+	AHPInsnIndex index;
+	AHPInfo info;
+	int i = 0;
+
+	initCode(&info, &section, 1, data);
+
+	TEST_CHECK(ahp_insn_index_build(&index, &info, 0, AHPCpu_68000));
+
+	for (uint32_t offset = 0; offset < index.size; offset = ahp_insn_next(&index, offset), ++i)
+	{
+		TEST_CHECK(i < 6 && offset == expectedStarts[i]);
+		TEST_CHECK(ahp_insn_is_start(&index, offset));
+	}
+
+	TEST_CHECK(i == 6);
+	TEST_CHECK(ahp_insn_find_start(&index, 5) == 2);
+	TEST_CHECK(ahp_insn_find_start(&index, 12) == 10);
+	TEST_CHECK(ahp_insn_find_start(&index, 100) == 16);
+	TEST_CHECK(ahp_insn_next(&index, 16) == sizeof(s_code));
+
+	ahp_insn_index_free(&index);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testBuildAll(void)
+{
+	enum { SectionCount = 9 };
+
+	uint8_t data[sizeof(s_code)];
+	AHPSection sections[SectionCount];
+	AHPInsnIndex indices[SectionCount];
+	AHPInsnIndex expected;
+	AHPInfo info;
+
+	initCode(&info, sections, SectionCount, data);
+	ahp_insn_index_build(&expected, &info, 0, AHPCpu_68000);
+
+	ahp_insn_index_build_all(indices, &info, AHPCpu_68000, 4);
+
+	for (int i = 0; i < SectionCount; ++i)
+	{
+		if (sections[i].type != AHPSectionType_Code)
+		{
+			TEST_CHECK(indices[i].size == 0 && indices[i].starts == 0);
+			continue;
+		}
+
+		TEST_CHECK(indices[i].size == expected.size);
+		TEST_CHECK(indices[i].starts && !memcmp(indices[i].starts, expected.starts, sizeof(uint32_t)));
+
+		ahp_insn_index_free(&indices[i]);
+	}
+
+	ahp_insn_index_free(&expected);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_insn(void)
+{
+	testLengths();
+	testIndex();
+	testBuildAll();
+}
@@ -0,0 +1,367 @@
+#include "test.h"
+#include "../doshunks.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HUNK_DEBUG_LINE 0x4C494E45
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// sectionCount sections of codeLongs longwords, libName (if any) ends up in the resident library list and moves
+// everything after the header
+
+static void putHeader(TestHunk* hunk, const char* libName, uint32_t sectionCount, uint32_t codeLongs)
+{
+	test_hunk_u32(hunk, HUNK_HEADER);
+
+	if (libName)
+		test_hunk_string(hunk, libName);
+
+	test_hunk_u32(hunk, 0);
+	test_hunk_u32(hunk, sectionCount);
+	test_hunk_u32(hunk, 0);
+	test_hunk_u32(hunk, sectionCount - 1);
+
+	for (uint32_t i = 0; i < sectionCount; ++i)
+		test_hunk_u32(hunk, codeLongs);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void putCode(TestHunk* hunk, uint32_t codeLongs)
+{
+	test_hunk_u32(hunk, HUNK_CODE);
+	test_hunk_u32(hunk, codeLongs);
+
+	for (uint32_t i = 0; i < codeLongs; ++i)
+		test_hunk_u32(hunk, 0x4e714e71);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Two longwords of code, a relocation at offset 4 to relocTarget, a symbol and a debug block that isn't LINE
+
+static void putSection(TestHunk* hunk, uint32_t relocTarget, const char* symbol)
+{
+	putCode(hunk, 2);
+
+	test_hunk_u32(hunk, HUNK_RELOC32);
+	test_hunk_u32(hunk, 1);
+	test_hunk_u32(hunk, relocTarget);
+	test_hunk_u32(hunk, 4);
+	test_hunk_u32(hunk, 0);
+
+	test_hunk_u32(hunk, HUNK_SYMBOL);
+	test_hunk_string(hunk, symbol);
+	test_hunk_u32(hunk, 0);
+	test_hunk_u32(hunk, 0);
+
+	test_hunk_u32(hunk, HUNK_DEBUG);
+	test_hunk_u32(hunk, 2);
+	test_hunk_u32(hunk, 0x41424344);
+	test_hunk_u32(hunk, 0x45464748);
+
+	test_hunk_u32(hunk, HUNK_END);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static AHPInfo* parseHunk(TestHunk* hunk, AHPInfo* prev)
+{
+	TEST_CHECK(test_hunk_save(hunk, TEST_TEMP_FILE));
+	test_hunk_free(hunk);
+
+	AHPInfo* info = prev ? ahp_reparse(prev, TEST_TEMP_FILE) : ahp_parse_file(TEST_TEMP_FILE);
+	remove(TEST_TEMP_FILE);
+
+	return info;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void putLines(TestHunk* hunk, uint32_t baseOffset, const char* filename, const uint32_t* pairs, int count)
+{
+	const uint32_t nameLongs = (uint32_t)(strlen(filename) + 3) / 4;
+
+	test_hunk_u32(hunk, HUNK_DEBUG);
+	test_hunk_u32(hunk, 3 + nameLongs + count * 2);
+	test_hunk_u32(hunk, baseOffset);
+	test_hunk_u32(hunk, HUNK_DEBUG_LINE);
+	test_hunk_string(hunk, filename);
+
+	for (int i = 0; i < count * 2; ++i)
+		test_hunk_u32(hunk, pairs[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// LINE entries as the compiler wrote them for code that got scheduled: not in address order, and two lines for
+// the same address
+
+static void testUnsortedLines(void)
+{
+	static const uint32_t pairs[] =
+	{
+		// line, address
+		10, 0,
+		14, 12,
+		11, 4,
+		13, 12,
+		12, 8,
+	};
+
+	const char* filename = 0;
+	TestHunk hunk = { 0 };
+	int line = 0;
+
+	putHeader(&hunk, 0, 1, 8);
+	putCode(&hunk, 8);
+	putLines(&hunk, 4, "main.c", pairs, 5);
+	test_hunk_u32(&hunk, HUNK_END);
+
+	AHPInfo* info = parseHunk(&hunk, 0);
+
+	TEST_CHECK(info != 0);
+
+	if (!info)
+		return;
+
+	const AHPSection* section = &info->sections[0];
+	const AHPLineInfo* lineInfo = &section->debugLines[0];
+
+	TEST_CHECK(section->debugLineCount == 1 && lineInfo->count == 5);
+
+	for (int i = 1; i < lineInfo->count; ++i)
+		TEST_CHECK(lineInfo->addresses[i - 1] <= lineInfo->addresses[i]);
+
+	TEST_CHECK(!ahp_find_line(section, 2, &filename, &line));
+	TEST_CHECK(ahp_find_line(section, 4, &filename, &line) && line == 10 && !strcmp(filename, "main.c"));
+	TEST_CHECK(ahp_find_line(section, 10, &filename, &line) && line == 11);
+	TEST_CHECK(ahp_find_line(section, 13, &filename, &line) && line == 12);
+
+	// same address keeps the file order, the last one is the closest
+
+	TEST_CHECK(lineInfo->lines[3] == 14 && lineInfo->lines[4] == 13);
+	TEST_CHECK(ahp_find_line(section, 16, &filename, &line) && line == 13);
+
+	ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int pointsInto(const AHPInfo* info, const char* text)
+{
+	return text >= (const char*)info->fileData && text < (const char*)info->fileData + info->sections[0].hunkStart +
+		   info->sections[0].hunkSize;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The first section is unchanged and can be reused but the second one is broken, prev must come out of it as it was
+
+static void testReparseFailure(void)
+{
+	TestHunk hunk = { 0 };
+
+	putHeader(&hunk, 0, 2, 2);
+	putSection(&hunk, 1, "_start");
+	putSection(&hunk, 0, "_data");
+
+	AHPInfo* prev = parseHunk(&hunk, 0);
+	TEST_CHECK(prev != 0);
+
+	if (!prev)
+		return;
+
+	const AHPSection* first = &prev->sections[0];
+	const uint32_t blockStart = first->debugBlocks[0].start;
+
+	putHeader(&hunk, 0, 2, 2);
+	putSection(&hunk, 1, "_start");
+	putCode(&hunk, 2);
+	test_hunk_u32(&hunk, HUNK_BREAK);
+
+	TEST_CHECK(parseHunk(&hunk, prev) == 0);
+
+	TEST_CHECK(first->symbolCount == 1 && first->relocCount == 1 && first->debugBlockCount == 1);
+	TEST_CHECK(pointsInto(prev, first->symbols[0].name) && !strcmp(first->symbols[0].name, "_start"));
+	TEST_CHECK(first->debugBlocks[0].start == blockStart);
+	TEST_CHECK(!memcmp((const uint8_t*)prev->fileData + blockStart, "ABCD", 4));
+
+	// prev still works for a reparse that succeeds, with everything moved by the library name in the header
+
+	putHeader(&hunk, "lib", 2, 2);
+	putSection(&hunk, 1, "_start");
+	putSection(&hunk, 0, "_data2");
+
+	AHPInfo* info = parseHunk(&hunk, prev);
+	TEST_CHECK(info != 0);
+
+	if (!info)
+	{
+		ahp_free(prev);
+		return;
+	}
+
+	first = &info->sections[0];
+
+	TEST_CHECK(first->symbolCount == 1 && first->relocCount == 1 && first->debugBlockCount == 1);
+	TEST_CHECK(pointsInto(info, first->symbols[0].name) && !strcmp(first->symbols[0].name, "_start"));
+	TEST_CHECK(first->debugBlocks[0].start == blockStart + 8);
+	TEST_CHECK(!memcmp((const uint8_t*)info->fileData + first->debugBlocks[0].start, "ABCD", 4));
+	TEST_CHECK(!memcmp((const uint8_t*)info->fileData + first->dataStart, "\x4e\x71\x4e\x71", 4));
+	TEST_CHECK(!strcmp(info->sections[1].symbols[0].name, "_data2"));
+
+	ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The first section is byte for byte the same but relocates against a section that isn't there anymore
+
+static void testReparseFewerSections(void)
+{
+	TestHunk hunk = { 0 };
+
+	putHeader(&hunk, 0, 2, 2);
+	putSection(&hunk, 1, "_start");
+	putSection(&hunk, 0, "_data");
+
+	AHPInfo* prev = parseHunk(&hunk, 0);
+	TEST_CHECK(prev != 0);
+
+	if (!prev)
+		return;
+
+	putHeader(&hunk, 0, 1, 2);
+	putSection(&hunk, 1, "_start");
+
+	TestHunk copy = { 0 };
+	copy.data = malloc(hunk.size);
+	copy.size = copy.capacity = hunk.size;
+	memcpy(copy.data, hunk.data, hunk.size);
+
+	TEST_CHECK(parseHunk(&copy, 0) == 0);
+	TEST_CHECK(parseHunk(&hunk, prev) == 0);
+	TEST_CHECK(prev->sections[0].relocCount == 1 && prev->sections[0].relocs[0].target == 1);
+
+	ahp_free(prev);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The first section shrinks so the unchanged second one is reused from further back in the old file
+
+static void putShrinkingHunk(TestHunk* hunk, uint32_t firstLongs)
+{
+	test_hunk_u32(hunk, HUNK_HEADER);
+	test_hunk_u32(hunk, 0);
+	test_hunk_u32(hunk, 2);
+	test_hunk_u32(hunk, 0);
+	test_hunk_u32(hunk, 1);
+	test_hunk_u32(hunk, firstLongs);
+	test_hunk_u32(hunk, 2);
+
+	putCode(hunk, firstLongs);
+	test_hunk_u32(hunk, HUNK_END);
+	putSection(hunk, 0, "_data");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testReparseShrink(void)
+{
+	TestHunk hunk = { 0 };
+
+	putShrinkingHunk(&hunk, 6);
+
+	AHPInfo* prev = parseHunk(&hunk, 0);
+	TEST_CHECK(prev != 0);
+
+	if (!prev)
+		return;
+
+	const uint32_t blockStart = prev->sections[1].debugBlocks[0].start;
+
+	putShrinkingHunk(&hunk, 2);
+
+	AHPInfo* info = parseHunk(&hunk, prev);
+	TEST_CHECK(info != 0);
+
+	if (!info)
+		return;
+
+	const AHPSection* second = &info->sections[1];
+	const char* end = (const char*)info->fileData + second->hunkStart + second->hunkSize;
+
+	TEST_CHECK(info->sections[0].memSize == 8 && second->hunkStart == info->sections[0].hunkStart + 20);
+	TEST_CHECK(second->symbolCount == 1 && second->relocCount == 1 && second->debugBlockCount == 1);
+	TEST_CHECK(second->symbols[0].name >= (const char*)info->fileData + second->hunkStart);
+	TEST_CHECK(second->symbols[0].name < end && !strcmp(second->symbols[0].name, "_data"));
+	TEST_CHECK(second->debugBlocks[0].start == blockStart - 16);
+	TEST_CHECK(!memcmp((const uint8_t*)info->fileData + second->debugBlocks[0].start, "ABCD", 4));
+	TEST_CHECK(!memcmp((const uint8_t*)info->fileData + second->dataStart, "\x4e\x71\x4e\x71", 4));
+	TEST_CHECK(second->relocStart > second->dataStart && second->relocStart < second->hunkStart + second->hunkSize);
+
+	ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A relocation in a section too small to hold a longword
+
+static void testRelocInTinySection(void)
+{
+	TestHunk hunk = { 0 };
+
+	putHeader(&hunk, 0, 1, 0);
+	putCode(&hunk, 0);
+	test_hunk_u32(&hunk, HUNK_RELOC32);
+	test_hunk_u32(&hunk, 1);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, 0);
+	test_hunk_u32(&hunk, HUNK_END);
+
+	TEST_CHECK(parseHunk(&hunk, 0) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Relocation targets are 16 bits, a file with more hunks than that must not have its targets truncated
+
+static void testTooManySections(void)
+{
+	const uint32_t sectionCount = 0x10001;
+	TestHunk hunk = { 0 };
+
+	putHeader(&hunk, 0, sectionCount, 1);
+
+	for (uint32_t i = 0; i < sectionCount; ++i)
+	{
+		putCode(&hunk, 1);
+
+		// 0x10000 would end up as 0
+
+		if (i == 0)
+		{
+			test_hunk_u32(&hunk, HUNK_RELOC32);
+			test_hunk_u32(&hunk, 1);
+			test_hunk_u32(&hunk, 0x10000);
+			test_hunk_u32(&hunk, 0);
+			test_hunk_u32(&hunk, 0);
+		}
+
+		test_hunk_u32(&hunk, HUNK_END);
+	}
+
+	AHPInfo* info = parseHunk(&hunk, 0);
+	TEST_CHECK(info == 0);
+
+	if (info)
+		ahp_free(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_parser(void)
+{
+	testUnsortedLines();
+	testReparseFailure();
+	testReparseFewerSections();
+	testReparseShrink();
+	testRelocInTinySection();
+	testTooManySections();
+}
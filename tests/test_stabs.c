@@ -0,0 +1,178 @@
+#include "test.h"
+#include "../amiga_hunk_stabs.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define N_GSYM 0x20
+#define N_FUN 0x24
+#define N_SLINE 0x44
+#define N_SO 0x64
+#define N_LSYM 0x80
+#define N_PSYM 0xa0
+#define N_LBRAC 0xc0
+#define N_RBRAC 0xe0
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct Stab
+{
+	uint8_t type;
+	const char* string;
+	uint32_t value;
+
+} Stab;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Two compilation units as GCC writes them: the first one with block and line addresses relative to the function
+// (a block at 0x20 in a function at 0x10 is at 0x30, not 0x20), the second one with absolute addresses
+
+static const Stab s_stabs[] =
+{
+	{ N_GSYM, "counter:G1", 0 },
+
+	{ N_SO, "a.c", 0 },
+	{ N_FUN, "f:F1", 0x10 },
+	{ N_PSYM, "q:p1", 8 },
+	{ N_LSYM, "x:1", (uint32_t)-4 },
+	{ N_PSYM, "p:p1", 12 },
+	{ N_SLINE, "", 0 },
+	{ N_LBRAC, "", 0x04 },
+	{ N_LSYM, "y:1", (uint32_t)-8 },
+	{ N_LBRAC, "", 0x20 },
+	{ N_RBRAC, "", 0x28 },
+	{ N_RBRAC, "", 0x30 },
+	{ N_FUN, "", 0x40 },
+	{ N_SO, "", 0 },
+
+	{ N_SO, "b.c", 0 },
+	{ N_FUN, "g:F1", 0x100 },
+	{ N_SLINE, "", 0x100 },
+	{ N_LSYM, "z:1", (uint32_t)-4 },
+	{ N_LBRAC, "", 0x104 },
+	{ N_RBRAC, "", 0x110 },
+	{ N_FUN, "", 0x20 },
+	{ N_SO, "", 0 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void putU32(uint8_t* out, uint32_t value)
+{
+	out[0] = (uint8_t)(value >> 24);
+	out[1] = (uint8_t)(value >> 16);
+	out[2] = (uint8_t)(value >> 8);
+	out[3] = (uint8_t)value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ZMAGIC, symbol table size, 12 byte nlist entries and the string table (its size includes the size field)
+
+static uint32_t buildBlock(uint8_t* out)
+{
+	const uint32_t count = sizeof(s_stabs) / sizeof(s_stabs[0]);
+	const uint32_t stringStart = 8 + count * 12;
+	uint32_t strx = 4;
+
+	putU32(out, 0x10b);
+	putU32(out + 4, count * 12);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		uint8_t* nlist = out + 8 + i * 12;
+		const size_t length = strlen(s_stabs[i].string) + 1;
+
+		putU32(nlist, strx);
+		nlist[4] = s_stabs[i].type;
+		nlist[5] = 0;
+		nlist[6] = nlist[7] = 0;
+		putU32(nlist + 8, s_stabs[i].value);
+
+		memcpy(out + stringStart + strx, s_stabs[i].string, length);
+		strx += (uint32_t)length;
+	}
+
+	putU32(out + stringStart, strx);
+
+	return (stringStart + strx + 3) & ~3u;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int isVariable(const AHPStabsIndex* index, uint32_t variable, const char* name, AHPVariableKind kind)
+{
+	const AHPStabsVariable* v = &index->variables[variable];
+
+	return v->kind == kind && v->nameLength == strlen(name) &&
+		   !strncmp(ahp_stabs_string(index, v->stab), name, v->nameLength);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_stabs(void)
+{
+	static uint8_t data[1024];
+	AHPDebugBlock block;
+	AHPSection section;
+	AHPInfo info;
+
+	memset(&section, 0, sizeof(section));
+	memset(&info, 0, sizeof(info));
+
+	block.start = 0;
+	block.size = buildBlock(data);
+
+	section.type = AHPSectionType_Code;
+	section.memSize = 0x200;
+	section.debugBlocks = &block;
+	section.debugBlockCount = 1;
+
+	info.sections = &section;
+	info.sectionCount = 1;
+	info.fileData = data;
+
+	AHPStabsIndex* index = ahp_stabs_index_build(&info, 0);
+	TEST_CHECK(index != 0);
+
+	if (!index)
+		return;
+
+	TEST_CHECK(index->functionCount == 2 && index->globalCount == 1);
+
+	const AHPStabsFunction* f = &index->functions[0];
+	const AHPStabsScope* scopes = &index->scopes[f->firstScope];
+
+	TEST_CHECK(f->start == 0x10 && f->end == 0x50 && f->scopeCount == 3);
+	TEST_CHECK(ahp_stabs_find_function(index, 0x4f) == f);
+	TEST_CHECK(ahp_stabs_find_function(index, 0x50) == 0);
+
+	// relative blocks
+
+	TEST_CHECK(scopes[1].start == 0x14 && scopes[1].end == 0x40);
+	TEST_CHECK(scopes[2].start == 0x30 && scopes[2].end == 0x38);
+	TEST_CHECK(ahp_stabs_find_scope(index, 0x32) == &scopes[2]);
+	TEST_CHECK(ahp_stabs_find_scope(index, 0x38) == &scopes[1]);
+	TEST_CHECK(ahp_stabs_find_scope(index, 0x12) == &scopes[0]);
+
+	// both parameters are in the function scope even though a local came between them
+
+	TEST_CHECK(scopes[0].variableCount == 2);
+	TEST_CHECK(isVariable(index, scopes[0].firstVariable, "q", AHPVariableKind_Param));
+	TEST_CHECK(isVariable(index, scopes[0].firstVariable + 1, "p", AHPVariableKind_Param));
+	TEST_CHECK(scopes[1].variableCount == 1 && isVariable(index, scopes[1].firstVariable, "x", AHPVariableKind_Local));
+	TEST_CHECK(scopes[2].variableCount == 1 && isVariable(index, scopes[2].firstVariable, "y", AHPVariableKind_Local));
+
+	// absolute blocks
+
+	const AHPStabsFunction* g = &index->functions[1];
+	scopes = &index->scopes[g->firstScope];
+
+	TEST_CHECK(g->start == 0x100 && g->end == 0x120 && g->scopeCount == 2);
+	TEST_CHECK(scopes[0].variableCount == 0);
+	TEST_CHECK(scopes[1].start == 0x104 && scopes[1].end == 0x110);
+	TEST_CHECK(scopes[1].variableCount == 1 && isVariable(index, scopes[1].firstVariable, "z", AHPVariableKind_Local));
+
+	uint32_t count = 0;
+	TEST_CHECK(ahp_stabs_functions_in_range(index, 0x40, 0x104, &count) == f && count == 2);
+
+	ahp_stabs_index_free(index);
+}
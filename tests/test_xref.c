@@ -0,0 +1,185 @@
+#include "test.h"
+#include "../amiga_hunk_xref.h"
+#include "../endian.h"
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CODE section of 0x40 bytes with its first symbol at 0x10 (and an alias there) and a DATA section of 0x10 bytes.
+// Nodes in order: <start of section 0>, _main/_alias, _helper, _unused, _table, _tail
+
+enum
+{
+	CodeSize = 0x40,
+	DataSize = 0x10,
+};
+
+static AHPSymbolInfo s_codeSymbols[] =
+{
+	{ "_main", 0x10 },
+	{ "_alias", 0x10 },
+	{ "_helper", 0x20 },
+	{ "_unused", 0x30 },
+};
+
+static AHPSymbolInfo s_dataSymbols[] =
+{
+	{ "_table", 0 },
+	{ "_tail", 8 },
+};
+
+// start of section -> _main, _main -> _table and _helper
+
+static AHPReloc s_codeRelocs[] =
+{
+	{ 0x02, 0, AHPRelocKind_Absolute, 4 },
+	{ 0x14, 1, AHPRelocKind_Absolute, 4 },
+	{ 0x18, 0, AHPRelocKind_Absolute, 4 },
+};
+
+// _table -> start of section 0 and _helper, _tail -> past the end of its own section
+
+static AHPReloc s_dataRelocs[] =
+{
+	{ 0x00, 0, AHPRelocKind_Absolute, 4 },
+	{ 0x04, 0, AHPRelocKind_Absolute, 4 },
+	{ 0x08, 1, AHPRelocKind_Absolute, 4 },
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void initInfo(AHPInfo* info, AHPSection* sections, uint8_t* data)
+{
+	memset(info, 0, sizeof(AHPInfo));
+	memset(sections, 0, 2 * sizeof(AHPSection));
+	memset(data, 0, CodeSize + DataSize);
+
+	ahp_store_be32(data + 0x02, 0x10);
+	ahp_store_be32(data + 0x14, 0);
+	ahp_store_be32(data + 0x18, 0x20);
+	ahp_store_be32(data + CodeSize + 0x00, 0x04);
+	ahp_store_be32(data + CodeSize + 0x04, 0x24);
+	ahp_store_be32(data + CodeSize + 0x08, 0x100);
+
+	sections[0].type = AHPSectionType_Code;
+	sections[0].memSize = sections[0].dataSize = CodeSize;
+	sections[0].symbols = s_codeSymbols;
+	sections[0].symbolCount = 4;
+	sections[0].relocs = s_codeRelocs;
+	sections[0].relocCount = 3;
+
+	sections[1].type = AHPSectionType_Data;
+	sections[1].memSize = sections[1].dataSize = DataSize;
+	sections[1].dataStart = CodeSize;
+	sections[1].symbols = s_dataSymbols;
+	sections[1].symbolCount = 2;
+	sections[1].relocs = s_dataRelocs;
+	sections[1].relocCount = 3;
+
+	info->sections = sections;
+	info->sectionCount = 2;
+	info->fileData = data;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int hasEdge(const AHPXref* xref, uint32_t from, uint32_t to)
+{
+	for (uint32_t e = xref->firstOut[from]; e < xref->firstOut[from + 1]; ++e)
+	{
+		if (xref->targets[e] == to)
+			return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testNodes(const AHPXref* xref)
+{
+	TEST_CHECK(xref->nodeCount == 6 && xref->edgeCount == 6);
+
+	// the bytes before the first symbol get their own node, aliases share one
+
+	TEST_CHECK(xref->nodes[0].start == 0 && xref->nodes[0].symbolCount == 0);
+	TEST_CHECK(xref->nodes[1].start == 0x10 && xref->nodes[1].firstSymbol == 0 && xref->nodes[1].symbolCount == 2);
+	TEST_CHECK(xref->nodes[2].firstSymbol == 2 && xref->nodes[3].firstSymbol == 3);
+	TEST_CHECK(xref->nodes[4].section == 1 && xref->nodes[4].start == 0 && xref->nodes[4].symbolCount == 1);
+
+	TEST_CHECK(ahp_xref_find_node(xref, 0, 0x0f) == 0);
+	TEST_CHECK(ahp_xref_find_node(xref, 0, 0x10) == 1);
+	TEST_CHECK(ahp_xref_find_node(xref, 0, 0x3f) == 3);
+	TEST_CHECK(ahp_xref_find_node(xref, 1, 0x07) == 4);
+	TEST_CHECK(ahp_xref_find_node(xref, 1, 0x08) == 5);
+	TEST_CHECK(ahp_xref_find_node(xref, 1, 0x100) == 5);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testEdges(const AHPXref* xref)
+{
+	TEST_CHECK(hasEdge(xref, 0, 1));
+	TEST_CHECK(hasEdge(xref, 1, 4) && hasEdge(xref, 1, 2));
+	TEST_CHECK(hasEdge(xref, 4, 0) && hasEdge(xref, 4, 2));
+
+	// a reference past the end of the section lands on its last node
+
+	TEST_CHECK(hasEdge(xref, 5, 5));
+
+	TEST_CHECK(ahp_xref_fan_in(xref, 0) == 1);
+	TEST_CHECK(ahp_xref_fan_in(xref, 1) == 1);
+	TEST_CHECK(ahp_xref_fan_in(xref, 2) == 2);
+	TEST_CHECK(ahp_xref_fan_in(xref, 3) == 0);
+	TEST_CHECK(ahp_xref_fan_in(xref, 4) == 1);
+	TEST_CHECK(ahp_xref_fan_in(xref, 5) == 1);
+	TEST_CHECK(ahp_xref_fan_out(xref, 1) == 2 && ahp_xref_fan_out(xref, 3) == 0);
+
+	// sources of a node are sorted
+
+	TEST_CHECK(xref->sources[xref->firstIn[2]] == 1 && xref->sources[xref->firstIn[2] + 1] == 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void testReachable(const AHPXref* xref)
+{
+	static const uint8_t expected[] = { 1, 1, 1, 0, 1, 0 };
+
+	uint8_t* reached = ahp_xref_reachable(xref, 0);
+	TEST_CHECK(reached != 0);
+
+	if (!reached)
+		return;
+
+	TEST_CHECK(!memcmp(reached, expected, sizeof(expected)));
+
+	free(reached);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void test_xref(void)
+{
+	uint8_t data[CodeSize + DataSize];
+	AHPSection sections[2];
+	AHPInfo info;
+
+	initInfo(&info, sections, data);
+
+	AHPXref* xref = ahp_xref_build(&info);
+	TEST_CHECK(xref != 0);
+
+	if (!xref)
+		return;
+
+	testNodes(xref);
+
+	if (xref->nodeCount == 6)
+	{
+		testEdges(xref);
+		testReachable(xref);
+	}
+
+	ahp_xref_free(xref);
+}
@@ -1,9 +1,24 @@
-
 StaticLibrary {
 	Name = "AmigaHunkParser",
 
 	Sources = { 
 		"amiga_hunk_parser.c",
+		"amiga_hunk_insn.c",
+		"amiga_hunk_diff.c",
+		"amiga_hunk_stabs.c",
+		"amiga_hunk_writer.c",
+		"amiga_hunk_elf.c",
+		"amiga_hunk_compact.c",
+		"amiga_hunk_xref.c",
+	},
+}
+
+StaticLibrary {
+	Name = "AmigaHunkClient",
+	Config = { "macosx-*-*-*", "x11-*-*-*" },
+
+	Sources = { 
+		"amiga_hunk_client.c",
 	},
 }
 
@@ -12,6 +27,62 @@ Program {
 
 	Depends = { "AmigaHunkParser" },
 	Sources = { "test.c" }, 
+	Libs = { { "pthread"; Config = "x11-*-*-*" } },
+}
+
+Program {
+	Name = "ahp_tests",
+	Config = { "macosx-*-*-*", "x11-*-*-*" },
+
+	Depends = { "AmigaHunkParser" },
+	Sources = {
+		"tests/main.c",
+		"tests/test_compact.c",
+		"tests/test_diff.c",
+		"tests/test_elf.c",
+		"tests/test_index.c",
+		"tests/test_insn.c",
+		"tests/test_parser.c",
+		"tests/test_stabs.c",
+		"tests/test_xref.c",
+	},
+	Libs = { { "pthread"; Config = "x11-*-*-*" } },
+}
+
+Program {
+	Name = "ahpd",
+	Config = { "macosx-*-*-*", "x11-*-*-*" },
+
+	Depends = { "AmigaHunkParser", "AmigaHunkClient" },
+	Sources = { "ahp_daemon.c" }, 
+	Libs = { { "pthread"; Config = "x11-*-*-*" } },
+}
+
+Program {
+	Name = "ahp_bench",
+	Config = { "macosx-*-*-*", "x11-*-*-*" },
+
+	Depends = { "AmigaHunkParser", "AmigaHunkClient" },
+	Sources = { "ahp_bench.c" }, 
+	Libs = { { "pthread"; Config = "x11-*-*-*" } },
+}
+
+Program {
+	Name = "ahp_index",
+	Config = { "macosx-*-*-*", "x11-*-*-*" },
+
+	Depends = { "AmigaHunkParser" },
+	Sources = { "ahp_index.c" }, 
+	Libs = { { "pthread"; Config = "x11-*-*-*" } },
+}
+
+Program {
+	Name = "ahp_elf2hunk",
+	Config = { "macosx-*-*-*", "x11-*-*-*" },
+
+	Depends = { "AmigaHunkParser" },
+	Sources = { "ahp_elf2hunk.c" }, 
+	Libs = { { "pthread"; Config = "x11-*-*-*" } },
 }
 
 Default "test"